@@ -0,0 +1,191 @@
+#pragma once
+
+// Approximate signature search, for suggesting new signatures when a game update breaks one.
+// Finds the offsets where at most maxMismatches fixed bytes of a pattern differ. Every offset in a block of 16/32 gets its
+// own mismatch counter in a vector lane, and the pattern's fixed bytes are compared rarest first, so a block is usually
+// ruled out after a few compares once every lane is over the limit. Only used once an exact scan has already failed.
+
+#include "scanner.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace Memory
+{
+    struct ApproximateMatch
+    {
+        const std::uint8_t* address;
+        std::size_t mismatches;
+    };
+
+    // Fixed byte positions, rarest first
+    inline std::vector<std::size_t> ApproximateOrder(const Signature& pattern)
+    {
+        std::vector<std::size_t> order;
+        for (std::size_t i = 0; i < pattern.length; ++i) {
+            if (pattern.mask[i])
+                order.push_back(i);
+        }
+        std::stable_sort(order.begin(), order.end(), [&pattern](std::size_t a, std::size_t b) { return ByteFrequency[pattern.bytes[a]] < ByteFrequency[pattern.bytes[b]]; });
+        return order;
+    }
+
+    inline void AddApproximateMatch(std::vector<ApproximateMatch>& matches, ApproximateMatch match, std::size_t maxResults)
+    {
+        // Kept sorted by mismatches then address
+        auto position = std::upper_bound(matches.begin(), matches.end(), match, [](const ApproximateMatch& a, const ApproximateMatch& b) {
+            return a.mismatches < b.mismatches || (a.mismatches == b.mismatches && a.address < b.address);
+        });
+        if (position - matches.begin() >= (std::ptrdiff_t)maxResults)
+            return;
+        matches.insert(position, match);
+        if (matches.size() > maxResults)
+            matches.pop_back();
+    }
+
+    // Candidate offsets are [begin, count), every candidate has the whole pattern in bounds.
+    void FindApproximateScalar(const std::uint8_t* data, std::size_t begin, std::size_t count, const Signature& pattern, const std::vector<std::size_t>& order, std::size_t maxMismatches, std::size_t maxResults, std::vector<ApproximateMatch>& matches)
+    {
+        for (auto i = begin; i < count; ++i) {
+            std::size_t mismatches = 0;
+            for (auto j : order) {
+                if (data[i + j] != pattern.bytes[j] && ++mismatches > maxMismatches)
+                    break;
+            }
+            if (mismatches <= maxMismatches)
+                AddApproximateMatch(matches, { data + i, mismatches }, maxResults);
+        }
+    }
+
+    void FindApproximateSSE2(const std::uint8_t* data, std::size_t count, const Signature& pattern, const std::vector<std::size_t>& order, std::size_t maxMismatches, std::size_t maxResults, std::vector<ApproximateMatch>& matches)
+    {
+        const __m128i one = _mm_set1_epi8(1);
+        const __m128i limit = _mm_set1_epi8(static_cast<char>(maxMismatches));
+
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i mismatches = _mm_setzero_si128();
+            unsigned int alive = 0xFFFF;
+            for (auto j : order) {
+                __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + j));
+                __m128i equal = _mm_cmpeq_epi8(bytes, _mm_set1_epi8(static_cast<char>(pattern.bytes[j])));
+                mismatches = _mm_add_epi8(mismatches, _mm_andnot_si128(equal, one));
+                alive = static_cast<unsigned int>(_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_min_epu8(mismatches, limit), mismatches)));
+                if (!alive)
+                    break;
+            }
+
+            alignas(16) std::uint8_t counts[16];
+            _mm_store_si128(reinterpret_cast<__m128i*>(counts), mismatches);
+            for (; alive; alive &= alive - 1) {
+                auto bit = std::countr_zero(alive);
+                AddApproximateMatch(matches, { data + i + bit, counts[bit] }, maxResults);
+            }
+        }
+        FindApproximateScalar(data, i, count, pattern, order, maxMismatches, maxResults, matches);
+    }
+
+    SCANNER_TARGET_AVX2 void FindApproximateAVX2(const std::uint8_t* data, std::size_t count, const Signature& pattern, const std::vector<std::size_t>& order, std::size_t maxMismatches, std::size_t maxResults, std::vector<ApproximateMatch>& matches)
+    {
+        const __m256i one = _mm256_set1_epi8(1);
+        const __m256i limit = _mm256_set1_epi8(static_cast<char>(maxMismatches));
+
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i mismatches = _mm256_setzero_si256();
+            unsigned int alive = 0xFFFFFFFF;
+            for (auto j : order) {
+                __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + j));
+                __m256i equal = _mm256_cmpeq_epi8(bytes, _mm256_set1_epi8(static_cast<char>(pattern.bytes[j])));
+                mismatches = _mm256_add_epi8(mismatches, _mm256_andnot_si256(equal, one));
+                alive = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_min_epu8(mismatches, limit), mismatches)));
+                if (!alive)
+                    break;
+            }
+
+            alignas(32) std::uint8_t counts[32];
+            _mm256_store_si256(reinterpret_cast<__m256i*>(counts), mismatches);
+            for (; alive; alive &= alive - 1) {
+                auto bit = std::countr_zero(alive);
+                AddApproximateMatch(matches, { data + i + bit, counts[bit] }, maxResults);
+            }
+        }
+        _mm256_zeroupper();
+        FindApproximateScalar(data, i, count, pattern, order, maxMismatches, maxResults, matches);
+    }
+
+    // Returns up to maxResults offsets in the regions where at most maxMismatches fixed bytes differ, best first.
+    // Mismatch counts are bytes, so maxMismatches is capped at 255.
+    std::vector<ApproximateMatch> FindApproximate(const std::vector<ScanRegion>& regions, const Signature& pattern, std::size_t maxMismatches, std::size_t maxResults)
+    {
+        maxMismatches = std::min<std::size_t>(maxMismatches, 255);
+        auto order = ApproximateOrder(pattern);
+        if (order.empty() || maxResults == 0)
+            return {};
+
+        // Each chunk owns the offsets [0, ScanChunkSize), reading up to a pattern length past them
+        std::vector<ScanRegion> chunks;
+        for (const auto& region : regions) {
+            if (region.size <= pattern.length)
+                continue;
+            auto count = region.size - pattern.length;
+            for (std::size_t offset = 0; offset < count; offset += ScanChunkSize)
+                chunks.push_back({ region.data + offset, std::min(ScanChunkSize, count - offset) });
+        }
+
+        std::vector<std::vector<ApproximateMatch>> chunkMatches(chunks.size());
+        std::atomic<std::size_t> nextChunk = 0;
+        auto worker = [&] {
+            for (std::size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) {
+                switch (CurrentScanEngine) {
+                case ScanEngine::AVX2:
+                    FindApproximateAVX2(chunks[c].data, chunks[c].size, pattern, order, maxMismatches, maxResults, chunkMatches[c]);
+                    break;
+                case ScanEngine::SSE2:
+                    FindApproximateSSE2(chunks[c].data, chunks[c].size, pattern, order, maxMismatches, maxResults, chunkMatches[c]);
+                    break;
+                default:
+                    FindApproximateScalar(chunks[c].data, 0, chunks[c].size, pattern, order, maxMismatches, maxResults, chunkMatches[c]);
+                    break;
+                }
+            }
+        };
+
+        auto threadCount = std::min<std::size_t>({ std::max(1u, std::thread::hardware_concurrency()), 16, chunks.size() });
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < threadCount; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+
+        std::vector<ApproximateMatch> matches;
+        for (const auto& found : chunkMatches) {
+            for (const auto& match : found)
+                AddApproximateMatch(matches, match, maxResults);
+        }
+        return matches;
+    }
+
+    // The pattern with its differing fixed bytes replaced by the ones at match
+    std::string SuggestSignature(const Signature& pattern, const std::uint8_t* match)
+    {
+        static constexpr char hexDigits[] = "0123456789ABCDEF";
+        std::string suggestion;
+        for (std::size_t i = 0; i < pattern.length; ++i) {
+            if (i)
+                suggestion += ' ';
+            if (pattern.mask[i]) {
+                suggestion += hexDigits[match[i] >> 4];
+                suggestion += hexDigits[match[i] & 0xF];
+            }
+            else {
+                suggestion += "??";
+            }
+        }
+        return suggestion;
+    }
+}
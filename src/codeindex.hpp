@@ -0,0 +1,333 @@
+#pragma once
+
+#include "scanner.hpp"
+
+#include <Zydis.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <functional>
+#include <optional>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Cross-reference index over a module's code, built once by disassembling it with Zydis (from safetyhook).
+// Records every direct call, every RIP-relative data reference and every function start, sorted by target so lookups
+// are a binary search. Function starts come from the exception directory (every x64 function that isn't a leaf has an
+// entry) plus every direct call target, which catches the leaf functions.
+// Code is decoded linearly between function boundaries, resyncing at every entry in the exception directory, so jump
+// tables or padding can only add a few junk references inside the function they're in.
+
+namespace Memory
+{
+    class CodeIndex
+    {
+    public:
+        // Both as RVAs, to keep the index small
+        struct Reference
+        {
+            std::uint32_t target;
+            std::uint32_t site;
+
+            bool operator<(const Reference& other) const { return target < other.target || (target == other.target && site < other.site); }
+        };
+
+        bool Build(void* module)
+        {
+            base = reinterpret_cast<std::uint8_t*>(module);
+            auto dosHeader = (PIMAGE_DOS_HEADER)module;
+            auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+            imageSize = ntHeaders->OptionalHeader.SizeOfImage;
+
+            ReadExceptionDirectory(ntHeaders);
+
+            // Split the code into runs between function boundaries, then group the runs into roughly even work units
+            std::vector<std::uint32_t> boundaries;
+            for (const auto& function : unwindFunctions) {
+                boundaries.push_back(function.begin);
+                boundaries.push_back(function.end);
+            }
+            std::sort(boundaries.begin(), boundaries.end());
+
+            std::vector<std::pair<std::uint32_t, std::uint32_t>> units;
+            for (const auto& region : GetScanRegions(module, ScanScope::Code)) {
+                auto begin = (std::uint32_t)(region.data - base);
+                auto end = (std::uint32_t)(begin + region.size);
+                for (auto unitBegin = begin; unitBegin < end;) {
+                    // Cut each unit at the first boundary after the target size, so no instruction straddles two units
+                    auto unitEnd = std::min<std::uint64_t>((std::uint64_t)unitBegin + WorkUnitSize, end);
+                    auto boundary = std::lower_bound(boundaries.begin(), boundaries.end(), (std::uint32_t)unitEnd);
+                    unitEnd = boundary != boundaries.end() && *boundary < end ? *boundary : end;
+                    units.push_back({ unitBegin, (std::uint32_t)unitEnd });
+                    unitBegin = (std::uint32_t)unitEnd;
+                }
+            }
+            if (units.empty())
+                return false;
+
+            std::vector<std::vector<Reference>> threadCalls;
+            std::vector<std::vector<Reference>> threadData;
+            std::atomic<std::size_t> nextUnit = 0;
+
+            auto threadCount = std::min<std::size_t>({ std::max(1u, std::thread::hardware_concurrency()), 16, units.size() });
+            threadCalls.resize(threadCount);
+            threadData.resize(threadCount);
+
+            auto worker = [&](std::size_t t) {
+                ZydisDecoder decoder;
+                ZydisDecoderInit(&decoder, ZYDIS_MACHINE_MODE_LONG_64, ZYDIS_STACK_WIDTH_64);
+                for (auto u = nextUnit++; u < units.size(); u = nextUnit++)
+                    DecodeUnit(decoder, units[u].first, units[u].second, boundaries, threadCalls[t], threadData[t]);
+            };
+
+            std::vector<std::thread> threads;
+            for (std::size_t t = 1; t < threadCount; ++t)
+                threads.emplace_back(worker, t);
+            worker(0);
+            for (auto& thread : threads)
+                thread.join();
+
+            Merge(threadCalls, calls);
+            Merge(threadData, dataReferences);
+
+            // Every call target starts a function, including the leaf functions the exception directory doesn't list
+            for (const auto& function : unwindFunctions) {
+                if (function.primary)
+                    functionStarts.push_back(function.begin);
+            }
+            for (const auto& call : calls) {
+                if (functionStarts.empty() || functionStarts.back() != call.target)
+                    functionStarts.push_back(call.target);
+            }
+            std::sort(functionStarts.begin(), functionStarts.end());
+            functionStarts.erase(std::unique(functionStarts.begin(), functionStarts.end()), functionStarts.end());
+            return true;
+        }
+
+        std::size_t CallCount() const { return calls.size(); }
+        std::size_t DataReferenceCount() const { return dataReferences.size(); }
+        std::size_t FunctionCount() const { return functionStarts.size(); }
+
+        bool IsFunctionStart(const void* address) const
+        {
+            auto rva = ToRVA(address);
+            return rva && std::binary_search(functionStarts.begin(), functionStarts.end(), *rva);
+        }
+
+        // Start of the function containing address, or nullptr if it's before every known function
+        std::uint8_t* FunctionContaining(const void* address) const
+        {
+            auto rva = ToRVA(address);
+            if (!rva)
+                return nullptr;
+
+            // Prefer the exception directory, it knows where functions end
+            auto unwind = std::upper_bound(unwindFunctions.begin(), unwindFunctions.end(), *rva, [](std::uint32_t value, const UnwindFunction& function) { return value < function.begin; });
+            if (unwind != unwindFunctions.begin() && *rva < std::prev(unwind)->end)
+                return base + std::prev(unwind)->owner;
+
+            auto start = std::upper_bound(functionStarts.begin(), functionStarts.end(), *rva);
+            return start == functionStarts.begin() ? nullptr : base + *std::prev(start);
+        }
+
+        // Every call instruction that calls function
+        std::vector<std::uint8_t*> Callers(const void* function) const
+        {
+            return Sites(calls, function);
+        }
+
+        // Every instruction with a RIP-relative operand that points at address
+        std::vector<std::uint8_t*> References(const void* address) const
+        {
+            return Sites(dataReferences, address);
+        }
+
+        // Finds a null-terminated string outside of the code sections
+        std::uint8_t* FindString(std::string_view text) const
+        {
+            std::string terminated(text);
+            terminated.push_back('\0');
+            std::boyer_moore_horspool_searcher searcher(terminated.begin(), terminated.end());
+
+            auto code = GetScanRegions(base, ScanScope::Code);
+            for (const auto& region : GetScanRegions(base, ScanScope::Image)) {
+                // Split around the code sections
+                std::vector<ScanRegion> parts = { region };
+                for (const auto& excluded : code) {
+                    std::vector<ScanRegion> remaining;
+                    for (const auto& part : parts) {
+                        auto partEnd = part.data + part.size;
+                        auto excludedEnd = excluded.data + excluded.size;
+                        if (excludedEnd <= part.data || excluded.data >= partEnd) {
+                            remaining.push_back(part);
+                            continue;
+                        }
+                        if (excluded.data > part.data)
+                            remaining.push_back({ part.data, (std::size_t)(excluded.data - part.data) });
+                        if (excludedEnd < partEnd)
+                            remaining.push_back({ excludedEnd, (std::size_t)(partEnd - excludedEnd) });
+                    }
+                    parts = std::move(remaining);
+                }
+
+                for (const auto& part : parts) {
+                    auto end = part.data + part.size;
+                    for (auto current = part.data; current < end;) {
+                        auto match = std::search(current, end, searcher);
+                        if (match == end)
+                            break;
+                        // Has to be the whole string, not the tail of a longer one
+                        if (match == part.data || match[-1] == '\0')
+                            return const_cast<std::uint8_t*>(match);
+                        current = match + 1;
+                    }
+                }
+            }
+            return nullptr;
+        }
+
+        // Every function that references the string
+        std::vector<std::uint8_t*> FunctionsReferencing(std::string_view text) const
+        {
+            std::vector<std::uint8_t*> functions;
+            if (auto string = FindString(text)) {
+                for (auto site : References(string)) {
+                    auto function = FunctionContaining(site);
+                    if (function && std::find(functions.begin(), functions.end(), function) == functions.end())
+                        functions.push_back(function);
+                }
+            }
+            return functions;
+        }
+
+    private:
+        static constexpr std::size_t WorkUnitSize = 256 * 1024;
+        static constexpr std::uint8_t UnwindFlagChainInfo = 0x4;
+
+        struct UnwindFunction
+        {
+            std::uint32_t begin;
+            std::uint32_t end;
+            std::uint32_t owner;    // Start of the function a chained fragment belongs to, or begin
+            bool primary;
+        };
+
+        void ReadExceptionDirectory(PIMAGE_NT_HEADERS ntHeaders)
+        {
+            const auto& directory = ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_EXCEPTION];
+            auto entries = (const IMAGE_RUNTIME_FUNCTION_ENTRY*)(base + directory.VirtualAddress);
+            auto count = directory.VirtualAddress ? directory.Size / sizeof(IMAGE_RUNTIME_FUNCTION_ENTRY) : 0;
+
+            for (std::size_t i = 0; i < count; ++i) {
+                const auto* entry = &entries[i];
+                if (entry->BeginAddress >= entry->EndAddress || entry->EndAddress > imageSize)
+                    continue;
+
+                UnwindFunction function{ entry->BeginAddress, entry->EndAddress, entry->BeginAddress, true };
+
+                // Chained unwind info means this is a fragment of another function, follow the chain back to its start
+                for (int depth = 0; depth < 8; ++depth) {
+                    if (entry->UnwindData >= imageSize)
+                        break;
+                    auto unwindInfo = base + entry->UnwindData;
+                    if (!((unwindInfo[0] >> 3) & UnwindFlagChainInfo))
+                        break;
+
+                    // The parent entry follows the unwind codes, which are padded to an even count
+                    std::uint8_t codeCount = unwindInfo[2];
+                    entry = (const IMAGE_RUNTIME_FUNCTION_ENTRY*)(unwindInfo + 4 + ((codeCount + 1) & ~1) * 2);
+                    function.owner = entry->BeginAddress;
+                    function.primary = false;
+                }
+                unwindFunctions.push_back(function);
+            }
+            std::sort(unwindFunctions.begin(), unwindFunctions.end(), [](const auto& a, const auto& b) { return a.begin < b.begin; });
+        }
+
+        void DecodeUnit(const ZydisDecoder& decoder, std::uint32_t begin, std::uint32_t end, const std::vector<std::uint32_t>& boundaries, std::vector<Reference>& unitCalls, std::vector<Reference>& unitData) const
+        {
+            auto boundary = std::upper_bound(boundaries.begin(), boundaries.end(), begin);
+            ZydisDecodedInstruction instruction;
+
+            for (auto rva = begin; rva < end;) {
+                // Resync at function boundaries in case the previous function ended in data
+                auto limit = boundary != boundaries.end() && *boundary < end ? *boundary : end;
+                if (rva >= limit) {
+                    rva = limit;
+                    ++boundary;
+                    continue;
+                }
+
+                auto address = base + rva;
+                if (*address == 0xCC) {     // Padding
+                    ++rva;
+                    continue;
+                }
+
+                if (!ZYAN_SUCCESS(ZydisDecoderDecodeInstruction(&decoder, nullptr, address, limit - rva, &instruction))) {
+                    ++rva;
+                    continue;
+                }
+
+                if (instruction.attributes & ZYDIS_ATTRIB_IS_RELATIVE) {
+                    auto next = (std::int64_t)rva + instruction.length;
+                    if (instruction.raw.imm[0].is_relative) {
+                        auto target = next + instruction.raw.imm[0].value.s;
+                        if (instruction.mnemonic == ZYDIS_MNEMONIC_CALL && target >= 0 && target < (std::int64_t)imageSize)
+                            unitCalls.push_back({ (std::uint32_t)target, rva });
+                    }
+                    else if ((instruction.attributes & ZYDIS_ATTRIB_HAS_MODRM) && instruction.raw.modrm.mod == 0 && instruction.raw.modrm.rm == 5) {
+                        // RIP-relative memory operand
+                        auto target = next + instruction.raw.disp.value;
+                        if (target >= 0 && target < (std::int64_t)imageSize)
+                            unitData.push_back({ (std::uint32_t)target, rva });
+                    }
+                }
+                rva += instruction.length;
+            }
+        }
+
+        static void Merge(std::vector<std::vector<Reference>>& parts, std::vector<Reference>& merged)
+        {
+            std::size_t total = 0;
+            for (const auto& part : parts)
+                total += part.size();
+            merged.reserve(total);
+            for (auto& part : parts) {
+                merged.insert(merged.end(), part.begin(), part.end());
+                std::vector<Reference>().swap(part);
+            }
+            std::sort(merged.begin(), merged.end());
+        }
+
+        std::optional<std::uint32_t> ToRVA(const void* address) const
+        {
+            auto pointer = static_cast<const std::uint8_t*>(address);
+            if (!base || pointer < base || pointer >= base + imageSize)
+                return std::nullopt;
+            return (std::uint32_t)(pointer - base);
+        }
+
+        std::vector<std::uint8_t*> Sites(const std::vector<Reference>& references, const void* target) const
+        {
+            std::vector<std::uint8_t*> sites;
+            auto rva = ToRVA(target);
+            if (!rva)
+                return sites;
+
+            auto range = std::equal_range(references.begin(), references.end(), Reference{ *rva, 0 }, [](const Reference& a, const Reference& b) { return a.target < b.target; });
+            for (auto it = range.first; it != range.second; ++it)
+                sites.push_back(base + it->site);
+            return sites;
+        }
+
+        std::uint8_t* base = nullptr;
+        std::uint32_t imageSize = 0;
+        std::vector<UnwindFunction> unwindFunctions;
+        std::vector<std::uint32_t> functionStarts;
+        std::vector<Reference> calls;
+        std::vector<Reference> dataReferences;
+    };
+}
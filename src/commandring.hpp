@@ -0,0 +1,197 @@
+#pragma once
+
+#include "platform.hpp"
+#include "cvarlist.hpp"
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+
+// Command channel for setting cvars from another process while the game runs.
+// A named shared-memory ring with one writer (the external tool) and one reader (the game thread). The writer fills
+// slots past head and only then moves head, so the reader sees whole batches or nothing. The reader copies commands out
+// before moving tail, and never trusts the contents, since anything in the session can write to the block.
+// See tools/cvarsend.cpp for a client.
+
+namespace Commands
+{
+    constexpr std::uint32_t RingMagic = 0x52444D43;     // "CMDR"
+    constexpr std::uint32_t RingVersion = 1;
+    constexpr std::size_t RingSlots = 256;              // Must be a power of two
+    constexpr std::uint32_t EndOfBatch = 1;
+
+    struct Command
+    {
+        char name[64];
+        char value[184];
+        std::uint32_t flags;    // EndOfBatch on the last command of a batch
+        std::uint32_t reserved;
+    };
+
+    struct SharedRing
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t slots;
+        std::uint32_t slotSize;
+        alignas(64) std::atomic<std::uint64_t> head;    // Only written by the writer
+        alignas(64) std::atomic<std::uint64_t> tail;    // Only written by the reader
+        alignas(64) Command commands[RingSlots];
+    };
+
+    static_assert(sizeof(Command) == 256);
+    static_assert((RingSlots & (RingSlots - 1)) == 0);
+
+    // Sets up a ring in zeroed memory, or resynchronises one that's already set up
+    void InitialiseRing(SharedRing& ring)
+    {
+        if (ring.magic != RingMagic) {
+            ring.slots = RingSlots;
+            ring.slotSize = sizeof(Command);
+            ring.version = RingVersion;
+            ring.head.store(0, std::memory_order_relaxed);
+            ring.tail.store(0, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            ring.magic = RingMagic;
+        }
+        else {
+            // Left over from an earlier run, anything still queued is stale
+            ring.tail.store(ring.head.load(std::memory_order_acquire), std::memory_order_release);
+        }
+    }
+
+    class Writer
+    {
+    public:
+        explicit Writer(SharedRing& ring) : ring(ring) {}
+
+        // Queues assignments as one batch. Fails without queuing anything if the ring is full or a name or value is too long.
+        bool Push(std::span<const std::pair<std::string_view, std::string_view>> batch)
+        {
+            if (batch.empty() || batch.size() > RingSlots)
+                return false;
+            for (const auto& [name, value] : batch) {
+                if (name.empty() || name.size() >= sizeof(Command::name) || value.size() >= sizeof(Command::value))
+                    return false;
+            }
+
+            auto head = ring.head.load(std::memory_order_relaxed);
+            auto tail = ring.tail.load(std::memory_order_acquire);
+            if (RingSlots - (head - tail) < batch.size())
+                return false;
+
+            for (std::size_t i = 0; i < batch.size(); ++i) {
+                auto& command = ring.commands[(head + i) & (RingSlots - 1)];
+                std::memset(&command, 0, sizeof(command));
+                std::memcpy(command.name, batch[i].first.data(), batch[i].first.size());
+                std::memcpy(command.value, batch[i].second.data(), batch[i].second.size());
+                command.flags = (i + 1 == batch.size()) ? EndOfBatch : 0;
+            }
+            ring.head.store(head + batch.size(), std::memory_order_release);
+            return true;
+        }
+
+    private:
+        SharedRing& ring;
+    };
+
+    struct DrainResult
+    {
+        std::size_t batches = 0;
+        std::size_t commands = 0;
+        bool resynchronised = false;    // The writer left the ring in an impossible state and its contents were dropped
+    };
+
+    class Reader
+    {
+    public:
+        explicit Reader(SharedRing& ring) : ring(ring) {}
+
+        // Adds whole batches to cvars until the next one would go over maxCommands. The first batch is always taken, so a
+        // batch bigger than the budget still gets applied, just on its own.
+        DrainResult Drain(std::size_t maxCommands, CVarList& cvars)
+        {
+            DrainResult result;
+            if (ring.magic != RingMagic)
+                return result;
+
+            auto tail = ring.tail.load(std::memory_order_relaxed);
+            auto head = ring.head.load(std::memory_order_acquire);
+            if (head - tail > RingSlots) {
+                ring.tail.store(head, std::memory_order_release);
+                result.resynchronised = true;
+                return result;
+            }
+
+            while (tail != head) {
+                // A batch without an end ends at head
+                std::size_t length = 1;
+                while (tail + length != head && !(ring.commands[(tail + length - 1) & (RingSlots - 1)].flags & EndOfBatch))
+                    ++length;
+                if (result.commands && result.commands + length > maxCommands)
+                    break;
+
+                for (std::size_t i = 0; i < length; ++i) {
+                    const auto& command = ring.commands[(tail + i) & (RingSlots - 1)];
+                    auto name = Terminated(command.name);
+                    if (!name.empty())
+                        cvars.Add(name, Terminated(command.value));
+                }
+                tail += length;
+                result.commands += length;
+                ++result.batches;
+            }
+
+            ring.tail.store(tail, std::memory_order_release);
+            return result;
+        }
+
+    private:
+        template<std::size_t N>
+        static std::string_view Terminated(const char (&text)[N])
+        {
+            return { text, strnlen(text, N) };
+        }
+
+        SharedRing& ring;
+    };
+
+#ifdef _WIN32
+    // Creates (or reopens) the named ring. Kept mapped for the life of the process.
+    SharedRing* CreateSharedRing(const std::wstring& name)
+    {
+        HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedRing), name.c_str());
+        if (!mapping)
+            return nullptr;
+
+        auto ring = static_cast<SharedRing*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedRing)));
+        if (!ring) {
+            CloseHandle(mapping);
+            return nullptr;
+        }
+        InitialiseRing(*ring);
+        return ring;
+    }
+
+    // Opens a ring created by the game, for writers
+    SharedRing* OpenSharedRing(const std::wstring& name)
+    {
+        HANDLE mapping = OpenFileMappingW(FILE_MAP_ALL_ACCESS, FALSE, name.c_str());
+        if (!mapping)
+            return nullptr;
+
+        auto ring = static_cast<SharedRing*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedRing)));
+        if (!ring || ring->magic != RingMagic || ring->version != RingVersion || ring->slots != RingSlots || ring->slotSize != sizeof(Command)) {
+            if (ring)
+                UnmapViewOfFile(ring);
+            CloseHandle(mapping);
+            return nullptr;
+        }
+        return ring;
+    }
+#endif
+}
@@ -0,0 +1,144 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+// Catalog of the engine's cvars, generated from cvardump.txt by tools/cvargen.cpp (rerun it when the dump changes).
+// Names are stored in a minimal perfect hash table (hash and displace): a first hash picks a bucket, the bucket's seed
+// picks the slot, so a lookup is two hashes and one string compare. Names are case-insensitive, like the engine's.
+
+namespace CVarCatalog
+{
+    enum class Type : std::uint8_t
+    {
+        Int,
+        Float,
+        String
+    };
+
+    struct Entry
+    {
+        const char* name;
+        Type type;
+        const char* defaultValue;
+    };
+
+    constexpr char ToLower(char c)
+    {
+        return (c >= 'A' && c <= 'Z') ? (char)(c - 'A' + 'a') : c;
+    }
+
+    constexpr bool EqualsIgnoreCase(std::string_view a, std::string_view b)
+    {
+        if (a.size() != b.size())
+            return false;
+        for (std::size_t i = 0; i < a.size(); ++i) {
+            if (ToLower(a[i]) != ToLower(b[i]))
+                return false;
+        }
+        return true;
+    }
+
+    constexpr std::uint32_t Hash(std::string_view name, std::uint32_t seed)
+    {
+        std::uint32_t hash = 2166136261u ^ (seed * 0x9E3779B9u);
+        for (char c : name) {
+            hash ^= (std::uint8_t)ToLower(c);
+            hash *= 16777619u;
+        }
+
+        // FNV-1a alone distributes short, similar names poorly in the low bits
+        hash ^= hash >> 16;
+        hash *= 0x7FEB352Du;
+        hash ^= hash >> 15;
+        hash *= 0x846CA68Bu;
+        hash ^= hash >> 16;
+        return hash;
+    }
+
+    // eg. "-3"
+    constexpr bool IsInteger(std::string_view value)
+    {
+        if (!value.empty() && (value[0] == '-' || value[0] == '+'))
+            value.remove_prefix(1);
+        if (value.empty())
+            return false;
+        for (char c : value) {
+            if (c < '0' || c > '9')
+                return false;
+        }
+        return true;
+    }
+
+    // eg. "-3", "0.95", ".5", "1.35f", "1e-4"
+    constexpr bool IsNumber(std::string_view value)
+    {
+        if (!value.empty() && (value[0] == '-' || value[0] == '+'))
+            value.remove_prefix(1);
+        if (!value.empty() && (value.back() == 'f' || value.back() == 'F'))
+            value.remove_suffix(1);
+
+        bool digits = false;
+        bool point = false;
+        std::size_t i = 0;
+        for (; i < value.size(); ++i) {
+            if (value[i] >= '0' && value[i] <= '9')
+                digits = true;
+            else if (value[i] == '.' && !point)
+                point = true;
+            else
+                break;
+        }
+        if (!digits)
+            return false;
+
+        if (i < value.size() && (value[i] == 'e' || value[i] == 'E')) {
+            auto exponent = value.substr(i + 1);
+            return IsInteger(exponent);
+        }
+        return i == value.size();
+    }
+
+    constexpr Type TypeOf(std::string_view value)
+    {
+        if (IsInteger(value))
+            return Type::Int;
+        if (IsNumber(value))
+            return Type::Float;
+        return Type::String;
+    }
+}
+
+#ifndef CVARGEN
+#include "cvarcatalog_table.hpp"
+
+namespace CVarCatalog
+{
+    constexpr const Entry* Find(std::string_view name)
+    {
+        auto seed = Seeds[Hash(name, 0) % BucketCount];
+        const auto& entry = Entries[Hash(name, seed) % Count];
+        return EqualsIgnoreCase(entry.name, name) ? &entry : nullptr;
+    }
+
+    constexpr const char* TypeName(Type type)
+    {
+        switch (type) {
+        case Type::Int: return "integer";
+        case Type::Float: return "number";
+        default: return "string";
+        }
+    }
+
+    // Types are inferred from the default values, so an integer default only means the cvar is probably an integer
+    constexpr bool MatchesType(const Entry& entry, std::string_view value)
+    {
+        switch (entry.type) {
+        case Type::Int: return IsInteger(value);
+        case Type::Float: return IsNumber(value);
+        default: return true;
+        }
+    }
+}
+#endif
@@ -0,0 +1,84 @@
+#pragma once
+
+#include "cvarcatalog.hpp"
+
+#include <cstddef>
+#include <span>
+#include <string_view>
+#include <vector>
+
+// idCVar assignment as passed to idCmdSystemLocal's SetCVar
+struct CVar {
+    int type;
+    const char* name;
+    const char* value;
+};
+
+// A list of cvar assignments built once and applied many times.
+// Names and values are interned into one buffer and the CVar records point straight into it, so applying the list
+// (eg. from a hook on every level load) never parses or allocates. Setting the same cvar twice keeps the last value,
+// names are compared case-insensitively like the engine does.
+class CVarList
+{
+public:
+    void Add(std::string_view name, std::string_view value)
+    {
+        auto valueOffset = Intern(value);
+        for (auto& entry : entries) {
+            if (CVarCatalog::EqualsIgnoreCase(&storage[entry.name], name)) {
+                entry.value = valueOffset;
+                Build();
+                return;
+            }
+        }
+        entries.push_back({ Intern(name), valueOffset });
+        Build();
+    }
+
+    // Empties the list, keeping its capacity for the next use
+    void Clear()
+    {
+        storage.clear();
+        entries.clear();
+        records.clear();
+    }
+
+    // Room for count cvars and bytes of names and values (terminators included), so adding them doesn't allocate
+    void Reserve(std::size_t count, std::size_t bytes)
+    {
+        storage.reserve(bytes);
+        entries.reserve(count);
+        records.reserve(count);
+    }
+
+    std::span<const CVar> Records() const { return records; }
+    std::size_t Size() const { return records.size(); }
+    bool Empty() const { return records.empty(); }
+
+private:
+    struct Entry
+    {
+        std::size_t name;
+        std::size_t value;
+    };
+
+    std::size_t Intern(std::string_view text)
+    {
+        auto offset = storage.size();
+        storage.insert(storage.end(), text.begin(), text.end());
+        storage.push_back('\0');
+        return offset;
+    }
+
+    // Storage may have moved, so the records are rebuilt whenever the list changes
+    void Build()
+    {
+        records.clear();
+        for (const auto& entry : entries)
+            records.push_back({ 2, &storage[entry.name], &storage[entry.value] });
+    }
+
+    std::vector<char> storage;
+    std::vector<Entry> entries;
+    std::vector<CVar> records;
+};
@@ -1,5 +1,24 @@
 #include "stdafx.h"
 #include "helper.hpp"
+#include "signatures.hpp"
+#include "tasks.hpp"
+#include "fov.hpp"
+#include "logging.hpp"
+#include "telemetry.hpp"
+#include "cvarlist.hpp"
+#include "cvarcatalog.hpp"
+#include "governor.hpp"
+#include "framecapture.hpp"
+#include "patch.hpp"
+#include "codeindex.hpp"
+#include "approxscan.hpp"
+#include "imports.hpp"
+#include "pacer.hpp"
+#include "modules.hpp"
+#include "commandring.hpp"
+#include "timeline.hpp"
+#include "hooks.hpp"
+#include "hooktrace.hpp"
 
 #include <spdlog/spdlog.h>
 #include <spdlog/sinks/rotating_file_sink.h>
@@ -19,6 +38,7 @@ std::filesystem::path sFixPath;
 // Ini
 inipp::Ini<char> ini;
 std::string sConfigFile = sFixName + ".ini";
+std::string sScanCacheFile = sFixName + ".cache";
 
 // Logger
 std::shared_ptr<spdlog::logger> logger;
@@ -28,7 +48,6 @@ std::string sExeName;
 
 // Aspect ratio / FOV / HUD
 std::pair DesktopDimensions = { 0,0 };
-const float fPi = 3.1415926535f;
 const float fNativeAspect = 2.37f;
 float fAspectRatio;
 float fAspectMultiplier;
@@ -45,14 +64,99 @@ bool bFixDLSSDOFDenoising;
 bool bUnrestrictCVars;
 bool bCutsceneFrameGeneration;
 bool bCutsceneFramerateUnlock;
+bool bAsyncLogging = true;
+int iLogFlushInterval = 1000;
+bool bTelemetry = false;
+int iTelemetryLogInterval = 60;
+bool bQualityGovernor = false;
+float fGovernorTargetFPS = 60.0f;
+bool bFrameCapture = false;
+std::string sCaptureTrigger = "Hotkey";
+std::string sCaptureHotkey = "0x7A";
+int iCaptureDuration = 0;
+bool bCodeIndex = false;
+bool bFrameLimiter = false;
+float fFrameLimiterFPS = 116.0f;
+bool bCommandChannel = false;
+int iCommandChannelBudget = 32;
+bool bStartupTimeline = false;
+bool bHookTrace = false;
+int iHookTraceCalls = 100000;
 
 // Variables
 int iCurrentResX;
 int iCurrentResY;
 uint8_t* idCmdSystemLocal = nullptr;
+CVarList LevelLoadCVars;
+CVarList CutsceneCVars;
+CVarList GameplayCVars;
+
+// [Module Patches], written into DLLs loaded after startup as each one loads (see WatchModules())
+struct ModulePatch
+{
+    std::string name;
+    std::string moduleName;
+    Memory::Signature signature;
+    Memory::Signature bytes;    // No wildcards, written at the start of the match
+};
+std::vector<ModulePatch> ModulePatches;
+std::vector<CVarList> GovernorLevels;
+
+// Resolved signatures, one per fix
+struct SignatureMatch
+{
+    std::uint8_t* address = nullptr;                // Match plus the variant's offset
+    const SignatureVariant* variant = nullptr;
+};
+std::array<SignatureMatch, (std::size_t)Sig::Count> ScanResults{};
+
+// Hook telemetry
+Telemetry::Probe SkipIntroVideoProbe("Skip Intro Video");
+Telemetry::Probe ReadOnlyCvarProbe("Read-Only Cvars");
+Telemetry::Probe idCmdSystemProbe("idCmdSystemLocal");
+Telemetry::Probe LevelLoadCompletedProbe("LevelLoadCompleted()");
+Telemetry::Probe CutsceneFOVProbe("Cutscene FOV");
+Telemetry::Probe FrameTimingProbe("Frame Timing");
+
+// Hook traces, replayed with tools/hookreplay.cpp
+HookTrace::Recorder ReadOnlyCvarTrace(HookTrace::Hook::ReadOnlyCvar);
+HookTrace::Recorder CutsceneFOVTrace(HookTrace::Hook::CutsceneFOV);
+
+std::uint8_t* ScanResult(Sig sig)
+{
+    return ScanResults[(std::size_t)sig].address;
+}
+
+// Queues the byte patch of whichever variant of the fix was found
+bool PatchScanResult(Memory::PatchTransaction& patches, Sig sig, const char* name)
+{
+    const auto& result = ScanResults[(std::size_t)sig];
+    if (!result.address)
+        return false;
+
+    spdlog::info("{:s}: Address is {:s}+{:x}", name, sExeName.c_str(), result.address - (std::uint8_t*)exeModule);
+    patches.PatchBytes(result.address, result.variant->patch.data(), result.variant->patch.size(), name);
+    return true;
+}
+
+// Each startup task commits its own patches and hooks as soon as it's done, so a failure only reverts that task's fixes
+bool CommitPatches(Memory::PatchTransaction& patches, const char* name)
+{
+    if (patches.PatchCount() == 0 && patches.HookCount() == 0)
+        return false;
+
+    if (!patches.Commit()) {
+        spdlog::error("{:s}: {}. Nothing was applied.", name, patches.LastError());
+        return false;
+    }
+    spdlog::info("{:s}: Applied {} byte patch(es) and {} hook(s).", name, patches.PatchCount(), patches.HookCount());
+    return true;
+}
 
 void Logging()
 {
+    Timeline::Span span("Startup", "Logging");
+
     // Get path to DLL
     WCHAR dllPath[_MAX_PATH] = { 0 };
     GetModuleFileNameW(thisModule, dllPath, MAX_PATH);
@@ -73,7 +177,7 @@ void Logging()
         if (file.is_open()) file.close();
 
         // Create single log file that's size-limited to 10MB
-        logger = std::make_shared<spdlog::logger>(sFixName, std::make_shared<spdlog::sinks::rotating_file_sink_st>(sExePath.string() + sLogFile, 10 * 1024 * 1024, 1));
+        logger = std::make_shared<spdlog::logger>(sFixName, std::make_shared<spdlog::sinks::rotating_file_sink_mt>(sExePath.string() + sLogFile, 10 * 1024 * 1024, 1));
         spdlog::set_default_logger(logger);
         spdlog::flush_on(spdlog::level::debug);
 
@@ -97,8 +201,127 @@ void Logging()
     }  
 }
 
+// Adds every "name = value" in an ini section to a cvar list, checking each against the cvar catalog
+void ParseCVarSection(const std::string& section, CVarList& cvars)
+{
+    for (const auto& [name, value] : ini.sections[section]) {
+        // cvardump.txt isn't a complete list, so cvars missing from the catalog are still set, the warning is for typos
+        if (auto entry = CVarCatalog::Find(name)) {
+            if (!CVarCatalog::MatchesType(*entry, value))
+                spdlog::warn("Config Parse: {}: {} expects a(n) {} (default is \"{}\"), got \"{}\".", section, entry->name, CVarCatalog::TypeName(entry->type), entry->defaultValue, value);
+            cvars.Add(entry->name, value);
+        }
+        else {
+            spdlog::warn("Config Parse: {}: {} is not a known cvar, check it for typos.", section, name);
+            cvars.Add(name, value);
+        }
+        spdlog::info("Config Parse: {}: {} = {}", section, name, value);
+    }
+}
+
+// Reads [Module Patches], where each entry is "module.dll | signature | bytes"
+void ParseModulePatches()
+{
+    for (const auto& [name, value] : ini.sections["Module Patches"]) {
+        std::vector<std::string> fields;
+        std::stringstream stream(value);
+        std::string field;
+        while (std::getline(stream, field, '|')) {
+            field.erase(0, field.find_first_not_of(' '));
+            field.erase(field.find_last_not_of(' ') + 1);
+            fields.push_back(field);
+        }
+        if (fields.size() != 3 || fields[0].empty()) {
+            spdlog::warn("Config Parse: Module Patches: {} should be \"module.dll | signature | bytes\", skipped.", name);
+            continue;
+        }
+
+        try {
+            Memory::Signature signature(fields[1].c_str());
+            Memory::Signature bytes(fields[2].c_str());
+            if (std::any_of(bytes.mask.begin(), bytes.mask.begin() + bytes.length, [](std::uint8_t mask) { return mask != 0xFF; }))
+                throw "Bytes can't have wildcards.";
+            if (bytes.length > signature.length)
+                throw "Bytes can't be longer than the signature.";
+            ModulePatches.push_back({ name, fields[0], signature, bytes });
+            spdlog::info("Config Parse: Module Patches: {} = {}", name, value);
+        }
+        catch (const char* error) {
+            spdlog::warn("Config Parse: Module Patches: {}: {} Skipped.", name, error);
+        }
+    }
+}
+
+// Builds the governor's quality levels from [Quality Governor] Step1, Step2, ... (each "cvar value, cvar value, ...").
+// Steps are cumulative, so each level holds the full value of every cvar the ladder touches and switching to any level is
+// one batch. Level 0 uses Step0 if given, otherwise each cvar's default from the catalog.
+void BuildGovernorLevels()
+{
+    auto& section = ini.sections["Quality Governor"];
+    auto ParseStep = [&section](const std::string& key) {
+        std::vector<std::pair<std::string, std::string>> assignments;
+        auto it = section.find(key);
+        if (it == section.end())
+            return assignments;
+
+        std::stringstream stream(it->second);
+        std::string assignment;
+        while (std::getline(stream, assignment, ',')) {
+            auto begin = assignment.find_first_not_of(' ');
+            if (begin == std::string::npos)
+                continue;
+            assignment = assignment.substr(begin, assignment.find_last_not_of(' ') - begin + 1);
+            auto separator = assignment.find(' ');
+            if (separator == std::string::npos) {
+                spdlog::warn("Config Parse: Quality Governor: {}: \"{}\" is missing a value.", key, assignment);
+                continue;
+            }
+            auto name = assignment.substr(0, separator);
+            if (!CVarCatalog::Find(name))
+                spdlog::warn("Config Parse: Quality Governor: {}: {} is not a known cvar, check it for typos.", key, name);
+            assignments.emplace_back(name, assignment.substr(assignment.find_first_not_of(' ', separator)));
+        }
+        return assignments;
+    };
+
+    std::vector<std::vector<std::pair<std::string, std::string>>> steps;
+    for (std::size_t i = 1; section.contains("Step" + std::to_string(i)); ++i)
+        steps.push_back(ParseStep("Step" + std::to_string(i)));
+    if (steps.empty()) {
+        spdlog::warn("Config Parse: Quality Governor: No steps configured, the governor is disabled.");
+        return;
+    }
+
+    // Level 0 values
+    CVarList baseline;
+    for (const auto& [name, value] : ParseStep("Step0"))
+        baseline.Add(name, value);
+    for (const auto& step : steps) {
+        for (const auto& [name, value] : step) {
+            auto known = std::ranges::any_of(baseline.Records(), [&name](const CVar& cvar) { return CVarCatalog::EqualsIgnoreCase(cvar.name, name); });
+            if (known)
+                continue;
+            if (auto entry = CVarCatalog::Find(name))
+                baseline.Add(name, entry->defaultValue);
+            else
+                spdlog::warn("Config Parse: Quality Governor: {} has no default, add it to Step0 so it can be restored.", name);
+        }
+    }
+
+    GovernorLevels.push_back(baseline);
+    for (const auto& step : steps) {
+        CVarList level = GovernorLevels.back();
+        for (const auto& [name, value] : step)
+            level.Add(name, value);
+        GovernorLevels.push_back(level);
+    }
+    spdlog::info("Config Parse: Quality Governor: {} quality level(s), {} cvar(s).", GovernorLevels.size(), GovernorLevels.back().Size());
+}
+
 void Configuration()
 {
+    Timeline::Span span("Startup", "Configuration");
+
     // Inipp initialisation
     std::ifstream iniFile(sFixPath / sConfigFile);
     if (!iniFile) {
@@ -129,6 +352,24 @@ void Configuration()
     inipp::get_value(ini.sections["Fix DLSS DOF Denoising"], "Enabled", bFixDLSSDOFDenoising);
     inipp::get_value(ini.sections["Cutscene Frame Generation"], "Enabled", bCutsceneFrameGeneration);
     inipp::get_value(ini.sections["Cutscene Framerate Unlock"], "Enabled", bCutsceneFramerateUnlock);
+    inipp::get_value(ini.sections["Logging"], "Async", bAsyncLogging);
+    inipp::get_value(ini.sections["Logging"], "FlushInterval", iLogFlushInterval);
+    inipp::get_value(ini.sections["Telemetry"], "Enabled", bTelemetry);
+    inipp::get_value(ini.sections["Telemetry"], "LogInterval", iTelemetryLogInterval);
+    inipp::get_value(ini.sections["Startup Timeline"], "Enabled", bStartupTimeline);
+    inipp::get_value(ini.sections["Hook Trace"], "Enabled", bHookTrace);
+    inipp::get_value(ini.sections["Hook Trace"], "MaxCalls", iHookTraceCalls);
+    inipp::get_value(ini.sections["Quality Governor"], "Enabled", bQualityGovernor);
+    inipp::get_value(ini.sections["Quality Governor"], "TargetFramerate", fGovernorTargetFPS);
+    inipp::get_value(ini.sections["Frame Capture"], "Enabled", bFrameCapture);
+    inipp::get_value(ini.sections["Frame Capture"], "Trigger", sCaptureTrigger);
+    inipp::get_value(ini.sections["Frame Capture"], "Hotkey", sCaptureHotkey);
+    inipp::get_value(ini.sections["Frame Capture"], "Duration", iCaptureDuration);
+    inipp::get_value(ini.sections["Code Index"], "Enabled", bCodeIndex);
+    inipp::get_value(ini.sections["Frame Limiter"], "Enabled", bFrameLimiter);
+    inipp::get_value(ini.sections["Frame Limiter"], "TargetFramerate", fFrameLimiterFPS);
+    inipp::get_value(ini.sections["Command Channel"], "Enabled", bCommandChannel);
+    inipp::get_value(ini.sections["Command Channel"], "MaxCVarsPerFrame", iCommandChannelBudget);
 
     // Log ini parse
     spdlog_confparse(bSkipIntro);
@@ -138,8 +379,59 @@ void Configuration()
     spdlog_confparse(bFixDLSSDOFDenoising);
     spdlog_confparse(bCutsceneFrameGeneration);
     spdlog_confparse(bCutsceneFramerateUnlock);
+    spdlog_confparse(bAsyncLogging);
+    spdlog_confparse(iLogFlushInterval);
+    spdlog_confparse(bTelemetry);
+    spdlog_confparse(iTelemetryLogInterval);
+    spdlog_confparse(bStartupTimeline);
+    spdlog_confparse(bHookTrace);
+    spdlog_confparse(iHookTraceCalls);
+    spdlog_confparse(bQualityGovernor);
+    spdlog_confparse(fGovernorTargetFPS);
+    spdlog_confparse(bFrameCapture);
+    spdlog_confparse(sCaptureTrigger);
+    spdlog_confparse(sCaptureHotkey);
+    spdlog_confparse(iCaptureDuration);
+    spdlog_confparse(bCodeIndex);
+    spdlog_confparse(bFrameLimiter);
+    spdlog_confparse(fFrameLimiterFPS);
+    spdlog_confparse(bCommandChannel);
+    spdlog_confparse(iCommandChannelBudget);
+
+    // CVars set on every level load: the fixes first, then [CVars] so the user can override them
+    if (bFixCulling) {
+        // Fix culling issues
+        LevelLoadCVars.Add("r_gpuTriangleCullingOptions", "0");
+    }
+    if (bFixDLSSDOFDenoising) {
+        // Fix DLSS-RR failing to denoise correctly whenever DOF is active (eg. during cutscenes, or when journal is open)
+        LevelLoadCVars.Add("r_dofAfterTAAMode", "2");
+    }
+    ParseCVarSection("CVars", LevelLoadCVars);
+
+    // Profiles switched between when cutscenes start and end
+    ParseCVarSection("Cutscene CVars", CutsceneCVars);
+    ParseCVarSection("Gameplay CVars", GameplayCVars);
+
+    ParseModulePatches();
+
+    if (bQualityGovernor)
+        BuildGovernorLevels();
 
     spdlog::info("----------");
+
+    // Apply flush policy. Nothing else is logging yet, so the sink can be swapped safely.
+    iLogFlushInterval = std::max(iLogFlushInterval, 0);
+    if (bAsyncLogging) {
+        // Hooks only copy into a queue, the background writer does the file I/O and flushes on errors or every iLogFlushInterval
+        auto& sinks = logger->sinks();
+        sinks[0] = std::make_shared<Log::AsyncSink>(sinks[0], std::chrono::milliseconds(iLogFlushInterval));
+        logger->flush_on(spdlog::level::off);
+    }
+    else if (iLogFlushInterval > 0) {
+        logger->flush_on(spdlog::level::err);
+        spdlog::flush_every(std::chrono::seconds(std::max(iLogFlushInterval / 1000, 1)));
+    }
 }
 
 void CalculateAspectRatio(bool bLog)
@@ -183,21 +475,97 @@ void CalculateAspectRatio(bool bLog)
     }
 }
 
+// Scans for the given variants in one pass, and gives each fix that isn't resolved yet the first of its variants that matched
+std::size_t ScanVariants(const std::vector<const SignatureVariant*>& variants)
+{
+    // Some fixes share a pattern, only scan for it once
+    std::vector<Memory::Signature> signatures;
+    std::vector<std::size_t> signatureIndex;
+    std::unordered_map<std::uint64_t, std::size_t> seen;
+    for (auto variant : variants) {
+        auto [entry, added] = seen.try_emplace(Memory::SignatureHash(variant->signature, Memory::ScanScope::Code), signatures.size());
+        if (added)
+            signatures.push_back(variant->signature);
+        signatureIndex.push_back(entry->second);
+    }
+
+    std::size_t cacheHits = 0;
+    auto results = Memory::PatternScanBatchCached(exeModule, signatures, sFixPath / sScanCacheFile, &cacheHits);
+    for (std::size_t i = 0; i < variants.size(); ++i) {
+        auto& match = ScanResults[(std::size_t)variants[i]->sig];
+        auto result = results[signatureIndex[i]];
+        if (result && !match.address) {
+            match.address = result + variants[i]->offset;
+            match.variant = variants[i];
+        }
+    }
+    return cacheHits;
+}
+
+void ScanSignatures(const std::vector<Sig>& sigs)
+{
+    // Find every variant of the given fixes in one pass over the exe instead of one pass per signature.
+    // A variant recorded for this exe's timestamp is scanned for on its own, the other variants only if it misses.
+    auto start = std::chrono::high_resolution_clock::now();
+    auto timestamp = Memory::ModuleTimestamp(exeModule);
+
+    std::vector<const SignatureVariant*> variants;
+    std::vector<const SignatureVariant*> fallbacks;
+    for (auto sig : sigs) {
+        bool pinned = std::any_of(SignatureTable.begin(), SignatureTable.end(), [&](const auto& v) { return v.sig == sig && v.timestamp == timestamp; });
+        for (const auto& variant : SignatureTable) {
+            if (variant.sig != sig)
+                continue;
+            if (pinned && variant.timestamp != timestamp)
+                fallbacks.push_back(&variant);
+            else
+                variants.push_back(&variant);
+        }
+    }
+
+    std::size_t cacheHits = 0;
+    {
+        Timeline::Span span("Scan", sigs.size() == 1 ? SignatureNames[(std::size_t)sigs[0]] : "Signature batch");
+        cacheHits = ScanVariants(variants);
+    }
+    std::erase_if(fallbacks, [](const SignatureVariant* variant) { return ScanResults[(std::size_t)variant->sig].address != nullptr; });
+    if (!fallbacks.empty()) {
+        spdlog::warn("Pattern Scan: Signatures recorded for this exe version didn't all match, trying the other variants.");
+        Timeline::Span span("Scan", "Fallback variants");
+        cacheHits += ScanVariants(fallbacks);
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+
+    for (auto sig : sigs) {
+        const auto& match = ScanResults[(std::size_t)sig];
+        if (match.variant && match.variant->version)
+            spdlog::info("Pattern Scan: {:s}: Using {:s} signature.", SignatureNames[(std::size_t)sig], match.variant->version);
+    }
+    spdlog::info("Pattern Scan: Scanned {} signature variant(s) in {}ms ({} from cache).", variants.size() + fallbacks.size(), elapsed.count(), cacheHits);
+}
+
 void SkipIntro()
 {
     if (bSkipIntro) {
         // com_skipIntroVideo
-        std::uint8_t* SkipIntroVideoScanResult = Memory::PatternScan(exeModule, "0F 95 ?? ?? ?? FF 15 ?? ?? ?? ?? 48 8B ?? ?? 48 8D ?? ?? ?? ?? ??");
+        std::uint8_t* SkipIntroVideoScanResult = ScanResult(Sig::SkipIntroVideo);
         if (SkipIntroVideoScanResult) {
             spdlog::info("Skip Intro Video: Address is {:s}+{:x}", sExeName.c_str(), SkipIntroVideoScanResult - (std::uint8_t*)exeModule);
+            Memory::PatchTransaction SkipIntroPatches;
             static SafetyHookMid SkipIntroVideoMidHook{};
-            SkipIntroVideoMidHook = safetyhook::create_mid(SkipIntroVideoScanResult,
+            SkipIntroPatches.MidHook(SkipIntroVideoMidHook, SkipIntroVideoScanResult,
                 [](SafetyHookContext& ctx) {
+                    Telemetry::Scope scope(SkipIntroVideoProbe);
+
                     // Clear ZF
                     ctx.rflags &= ~(1 << 6);
 
-                    spdlog::info("Skip Intro Video: Skipped intro videos.");
-                });
+                    spdlog_ratelimited(1000, info, "Skip Intro Video: Skipped intro videos.");
+                }, "Skip Intro Video");
+
+            // The intro videos start right away, so this can't wait for the rest of the startup patches
+            if (!SkipIntroPatches.Commit())
+                spdlog::error("Skip Intro Video: {}", SkipIntroPatches.LastError());
         }
         else {
             spdlog::error("Skip Intro Video: Pattern scan failed.");
@@ -205,55 +573,114 @@ void SkipIntro()
     }
 }
 
-struct CVar {
-    int type;
-    const char* name;
-    const char* value;
-};
-
 using SetCVar_t = char(*)(void*, void*);
 SetCVar_t SetCVar_fn = nullptr;
 
-void SetCVar(const std::string& cvarString)
+// idCmdSystemLocal readiness
+// CVars set before the command system exists are queued. Any thread may notice it's ready, but cvars are only ever set
+// from the game thread (the LevelLoadCompleted and frame timing hooks), which applies the queue first.
+// Queued batches must outlive the queue, which is the case for CVarList globals.
+std::mutex CmdSystemMutex;
+std::atomic<bool> bCmdSystemReady = false;
+std::vector<std::span<const CVar>> QueuedCVars;
+std::atomic<bool> bQueuedCVars = false;
+std::int64_t CmdSystemWaitStart = 0;
+
+// Hooked right after the command system's constructor, and disabled once it's done its job.
+// bCmdSystemHookInstalled is set once it's committed, so the hook object isn't touched before then.
+SafetyHookMid idCmdSystemMidHook{};
+std::atomic<bool> bCmdSystemHookInstalled = false;
+std::atomic<bool> bDisableCmdSystemHook = false;
+
+void ApplyCVars(std::span<const CVar> cvars)
 {
-    if (!SetCVar_fn || !idCmdSystemLocal) {
-        spdlog::error("Set CVar: Function address or idCmdSystemLocal address incorrect.");
-        return;
+    for (auto cvar : cvars) {
+        SetCVar_fn(idCmdSystemLocal, &cvar);
+        spdlog::info("Set CVar: {} = {}", cvar.name, cvar.value);
     }
+}
 
-    auto separator = cvarString.find(' ');
-    if (separator == std::string::npos)
-        return;
+// Marks the command system ready if it's been constructed. Safe on any thread, never sets cvars itself.
+bool CheckCmdSystem()
+{
+    if (bCmdSystemReady.load(std::memory_order_acquire))
+        return true;
 
-    std::string name = cvarString.substr(0, separator);
-    std::string value = cvarString.substr(separator + 1);
+    std::scoped_lock lock(CmdSystemMutex);
+    if (bCmdSystemReady)
+        return true;
 
-    CVar cvar{ 2, name.c_str(), value.c_str() };
+    // idCmdSystemLocal is constructed once its vtable pointer is set
+    if (!SetCVar_fn || !idCmdSystemLocal || !*(void**)idCmdSystemLocal)
+        return false;
 
-    SetCVar_fn(idCmdSystemLocal, &cvar);
-    spdlog::info("Set CVar: {} = {}", name, value);
+    auto now = Timeline::Now();
+    Timeline::Add("Wait", "idCmdSystemLocal", CmdSystemWaitStart ? CmdSystemWaitStart : now, now);
+    bCmdSystemReady.store(true, std::memory_order_release);
+    bDisableCmdSystemHook.store(true, std::memory_order_release);
+    return true;
+}
+
+// Game thread only. Applies whatever was queued before the command system was up, and returns whether it's up.
+bool FlushQueuedCVars()
+{
+    if (!CheckCmdSystem())
+        return false;
+
+    if (bCmdSystemHookInstalled.load(std::memory_order_acquire) && bDisableCmdSystemHook.exchange(false, std::memory_order_acq_rel) && idCmdSystemMidHook.enabled()) {
+        // Disabled rather than reset, another thread could still be inside it
+        if (!idCmdSystemMidHook.disable())
+            spdlog::warn("idCmdSystemLocal: Failed to disable hook.");
+    }
+
+    if (!bQueuedCVars.load(std::memory_order_acquire))
+        return true;
+
+    std::vector<std::span<const CVar>> queued;
+    {
+        std::scoped_lock lock(CmdSystemMutex);
+        queued.swap(QueuedCVars);
+        bQueuedCVars.store(false, std::memory_order_release);
+    }
+
+    spdlog::info("idCmdSystemLocal: Command system is ready, applying {} queued cvar batch(es).", queued.size());
+    for (auto cvars : queued)
+        ApplyCVars(cvars);
+    return true;
+}
+
+// Game thread only
+void SetCVars(std::span<const CVar> cvars)
+{
+    if (FlushQueuedCVars()) {
+        ApplyCVars(cvars);
+        return;
+    }
+
+    {
+        std::scoped_lock lock(CmdSystemMutex);
+        if (!bCmdSystemReady) {
+            QueuedCVars.push_back(cvars);
+            bQueuedCVars.store(true, std::memory_order_release);
+            spdlog::info("Set CVar: Queued {} cvar(s) until idCmdSystemLocal is ready.", cvars.size());
+            return;
+        }
+    }
+
+    // Became ready in between, anything queued before goes first
+    FlushQueuedCVars();
+    ApplyCVars(cvars);
 }
 
 void CVars()
 {
+    Memory::PatchTransaction CVarPatches;
     if (bUnrestrictCVars) {
         // Remove cvar restrictions
-        std::uint8_t* ConsoleCVarRestrictionsScanResult = Memory::PatternScan(exeModule, "08 4C 8B 0E BA 01");
-        std::uint8_t* BindCVarRestrictionsScanResult = Memory::PatternScan(exeModule, "BA 01 00 00 00 49 ?? ?? 8B ?? 41 FF ?? ?? 8B ?? 8B ?? E8 ?? ?? ?? ??");
-        std::uint8_t* ExecCVarRestrictionsScanResult = Memory::PatternScan(exeModule, "BA 01 00 00 00 E8 ?? ?? ?? ?? 83 ?? ?? ?? ?? ?? 00 0F 84 ?? ?? ?? ??");
-        if (ConsoleCVarRestrictionsScanResult) {
-            spdlog::info("CVar Restrictions: Console: Address is {:s}+{:x}", sExeName.c_str(), ConsoleCVarRestrictionsScanResult - (std::uint8_t*)exeModule);
-            Memory::Write(ConsoleCVarRestrictionsScanResult + 0x5, (int)0);
-        }
-        if (BindCVarRestrictionsScanResult) {
-            spdlog::info("CVar Restrictions: Bind: Address is {:s}+{:x}", sExeName.c_str(), BindCVarRestrictionsScanResult - (std::uint8_t*)exeModule);
-            Memory::Write(BindCVarRestrictionsScanResult + 0x1, (int)0);
-        }
-        if (BindCVarRestrictionsScanResult) {
-            spdlog::info("CVar Restrictions: Exec: Address is {:s}+{:x}", sExeName.c_str(), ExecCVarRestrictionsScanResult - (std::uint8_t*)exeModule);
-            Memory::Write(ExecCVarRestrictionsScanResult + 0x1, (int)0);
-        }
-        if (ConsoleCVarRestrictionsScanResult && BindCVarRestrictionsScanResult && ExecCVarRestrictionsScanResult) {
+        bool bConsole = PatchScanResult(CVarPatches, Sig::ConsoleCVarRestrictions, "CVar Restrictions: Console");
+        bool bBind = PatchScanResult(CVarPatches, Sig::BindCVarRestrictions, "CVar Restrictions: Bind");
+        bool bExec = PatchScanResult(CVarPatches, Sig::ExecCVarRestrictions, "CVar Restrictions: Exec");
+        if (bConsole && bBind && bExec) {
             spdlog::info("CVar Restrictions: Disabled restrictions.");
         }
         else {
@@ -261,73 +688,149 @@ void CVars()
         }
 
         // Remove read-only flag check for cvars
-        std::uint8_t* ReadOnlyCvarScanResult = Memory::PatternScan(exeModule, "0F ?? ?? 0E 73 ?? 48 8B ?? ?? 48 8D ?? ?? ?? ?? ?? E8 ?? ?? ?? ??");
+        std::uint8_t* ReadOnlyCvarScanResult = ScanResult(Sig::ReadOnlyCvar);
         if (ReadOnlyCvarScanResult) {
             spdlog::info("Read-Only Cvars: Address is {:s}+{:x}", sExeName.c_str(), ReadOnlyCvarScanResult - (std::uint8_t*)exeModule);
+            if (bHookTrace)
+                ReadOnlyCvarTrace.Start((std::size_t)std::max(iHookTraceCalls, 0), 0.0f, 0, 0);
+
             static SafetyHookMid ReadOnlyCvarMidHook{};
-            ReadOnlyCvarMidHook = safetyhook::create_mid(ReadOnlyCvarScanResult,
+            CVarPatches.MidHook(ReadOnlyCvarMidHook, ReadOnlyCvarScanResult,
                 [](SafetyHookContext& ctx) {
-                    // Clear read-only flag (bit 15)
-                    ctx.rax &= ~(1 << 15);
-                    // Clear command-line only flag (bit 14)
-                    ctx.rax &= ~(1 << 14);
-                });
+                    Telemetry::Scope scope(ReadOnlyCvarProbe);
+
+                    if (ReadOnlyCvarTrace.Active()) {
+                        auto before = HookTrace::Capture(ctx);
+                        Hooks::ReadOnlyCvar(ctx);
+                        ReadOnlyCvarTrace.Add(before, HookTrace::Capture(ctx));
+                        return;
+                    }
+                    Hooks::ReadOnlyCvar(ctx);
+                }, "Read-Only Cvars");
         }
         else {
             spdlog::error("Read-Only Cvars: Pattern scan failed.");
         }
     }
+    CommitPatches(CVarPatches, "CVars");
+}
+
+// The idCmdSystem signature is lea, mov, mov, call (the constructor), so the constructor has returned by this offset
+constexpr std::ptrdiff_t idCmdSystemConstructedOffset = 0x17;
 
+void CmdSystem()
+{
     // Get idCmdSystemLocal
-    std::uint8_t* idCmdSystemScanResult = Memory::PatternScan(exeModule, "48 8D ?? ?? ?? ?? ?? 48 89 ?? ?? ?? ?? ?? 48 89 ?? ?? E8 ?? ?? ?? ?? 48 8B ?? ?? ?? ?? ?? 48 8D ?? ?? ?? ?? ?? B9 00 01 00 00");
+    std::uint8_t* idCmdSystemScanResult = ScanResult(Sig::idCmdSystem);
     if (idCmdSystemScanResult) {
         spdlog::info("idCmdSystemLocal: Address is {:s}+{:x}", sExeName.c_str(), idCmdSystemScanResult - (std::uint8_t*)exeModule);
-
-        for (int i = 0; i < 15; ++i) {
+        {
+            std::scoped_lock lock(CmdSystemMutex);
             idCmdSystemLocal = Memory::GetAbsolute(idCmdSystemScanResult + 0x3);
-            if (*(std::uint8_t*)idCmdSystemLocal)
-                break;
-            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            CmdSystemWaitStart = Timeline::Now();
         }
-
         spdlog::info("idCmdSystemLocal: idCmdSystemLocal address is {:x}", (uintptr_t)idCmdSystemLocal);
+
+        // Instead of polling, hook the instruction after the call that constructs it
+        Memory::PatchTransaction CmdSystemPatches;
+        CmdSystemPatches.MidHook(idCmdSystemMidHook, idCmdSystemScanResult + idCmdSystemConstructedOffset,
+            [](SafetyHookContext& ctx) {
+                Telemetry::Scope scope(idCmdSystemProbe);
+                CheckCmdSystem();
+            }, "idCmdSystemLocal");
+        if (CommitPatches(CmdSystemPatches, "idCmdSystemLocal"))
+            bCmdSystemHookInstalled.store(true, std::memory_order_release);
+
+        // It may already be up, in which case the game thread disables the hook
+        CheckCmdSystem();
     }
     else {
         spdlog::error("idCmdSystemLocal: Pattern scan failed.");
     }
+}
 
+void LevelLoadCompleted()
+{
     // Get SetCVar function
-    std::uint8_t* SetCVarScanResult = Memory::PatternScan(exeModule, "40 ?? 53 41 ?? 48 8D ?? ?? ?? 48 81 ?? ?? ?? ?? ?? 48 8B ?? ?? ?? ?? ?? 48 33 ?? 48 89 ?? ?? 8B ?? 4C 8B ??");
+    std::uint8_t* SetCVarScanResult = ScanResult(Sig::SetCVar);
     if (SetCVarScanResult) {
         spdlog::info("Set CVar Function: Address is {:s}+{:x}", sExeName.c_str(), SetCVarScanResult - (std::uint8_t*)exeModule);
-        SetCVar_fn = reinterpret_cast<SetCVar_t>(SetCVarScanResult);
+        {
+            std::scoped_lock lock(CmdSystemMutex);
+            SetCVar_fn = reinterpret_cast<SetCVar_t>(SetCVarScanResult);
+        }
+        CheckCmdSystem();
     }
     else {
         spdlog::error("Set CVar Function: Pattern scan failed.");
     }
 
     // idLoadScreen::LevelLoadCompleted()
-    std::uint8_t* LevelLoadCompletedScanResult = Memory::PatternScan(exeModule, "48 89 ?? ?? ?? 48 89 ?? ?? ?? 48 89 ?? ?? ?? 57 48 83 ?? ?? 48 8D ?? ?? ?? ?? ?? E8 ?? ?? ?? ??");
+    std::uint8_t* LevelLoadCompletedScanResult = ScanResult(Sig::LevelLoadCompleted);
     if (LevelLoadCompletedScanResult) {
         spdlog::info("LevelLoadCompleted(): Address is {:s}+{:x}", sExeName.c_str(), LevelLoadCompletedScanResult - (std::uint8_t*)exeModule);
+        Memory::PatchTransaction LevelLoadPatches;
         static SafetyHookMid LevelLoadCompletedMidHook{};
-        LevelLoadCompletedMidHook = safetyhook::create_mid(LevelLoadCompletedScanResult,
+        LevelLoadPatches.MidHook(LevelLoadCompletedMidHook, LevelLoadCompletedScanResult,
             [](SafetyHookContext& ctx) {
-                if (bFixCulling) {
-                    // Fix culling issues
-                    SetCVar("r_gpuTriangleCullingOptions 0");
-                }
-                if (bFixDLSSDOFDenoising) {
-                    // Fix DLSS-RR failing to denoise correctly whenever DOF is active (eg. during cutscenes, or when journal is open)
-                    SetCVar("r_dofAfterTAAMode 2");
-                }
-            });
+                Telemetry::Scope scope(LevelLoadCompletedProbe);
+                FlushQueuedCVars();
+
+                // Culling/DOF fixes and [CVars], pre-built in Configuration()
+                if (!LevelLoadCVars.Empty())
+                    SetCVars(LevelLoadCVars.Records());
+            }, "LevelLoadCompleted()");
+        CommitPatches(LevelLoadPatches, "LevelLoadCompleted()");
     }
     else {
         spdlog::error("LevelLoadCompleted(): Pattern scan failed.");
     }
 }
 
+// Cutscene/gameplay cvar profiles
+// The cutscene camera hook only flags that it ran. The frame timing hook, once per frame on the game thread, switches to
+// the cutscene profile on the first flagged frame and back to the gameplay profile after CutsceneEndFrames without one.
+std::atomic<bool> bCutsceneCameraHit = false;
+std::atomic<bool> bInCutscene = false;
+constexpr int CutsceneEndFrames = 5;
+
+bool HasCutsceneProfiles()
+{
+    return !CutsceneCVars.Empty() || !GameplayCVars.Empty();
+}
+
+// Cutscene state is also used to trigger frame captures
+bool TrackCutscenes()
+{
+    return HasCutsceneProfiles() || (bFrameCapture && sCaptureTrigger == "Cutscene");
+}
+
+void OnCutsceneFrame()
+{
+    bCutsceneCameraHit.store(true, std::memory_order_relaxed);
+}
+
+// Game thread only, once per frame
+void UpdateCutsceneState()
+{
+    static int framesWithoutCutscene = 0;
+    if (bCutsceneCameraHit.exchange(false, std::memory_order_relaxed)) {
+        framesWithoutCutscene = 0;
+        if (!bInCutscene.load(std::memory_order_relaxed)) {
+            bInCutscene.store(true, std::memory_order_relaxed);
+            spdlog::info("Cutscene CVars: Cutscene started, applying {} cvar(s).", CutsceneCVars.Size());
+            if (!CutsceneCVars.Empty())
+                SetCVars(CutsceneCVars.Records());
+        }
+    }
+    else if (bInCutscene.load(std::memory_order_relaxed) && ++framesWithoutCutscene >= CutsceneEndFrames) {
+        bInCutscene.store(false, std::memory_order_relaxed);
+        spdlog::info("Cutscene CVars: Cutscene ended, applying {} gameplay cvar(s).", GameplayCVars.Size());
+        if (!GameplayCVars.Empty())
+            SetCVars(GameplayCVars.Records());
+    }
+}
+
 void AspectRatioFOV()
 {
     // Grab desktop resolution/aspect just in case
@@ -336,35 +839,45 @@ void AspectRatioFOV()
     iCurrentResY = DesktopDimensions.second;
     CalculateAspectRatio(true);
 
-    if (bFixCutsceneFOV) {
+    // The cutscene camera hook also drives the cutscene/gameplay cvar profiles and cutscene frame captures
+    if (bFixCutsceneFOV || TrackCutscenes()) {
+        static FOV::CutsceneFOV CutsceneFOVTransform(fNativeAspect);
+        CutsceneFOVTransform.SetResolution(iCurrentResX, iCurrentResY);
+        if (bHookTrace && bFixCutsceneFOV)
+            CutsceneFOVTrace.Start((std::size_t)std::max(iHookTraceCalls, 0), fNativeAspect, iCurrentResX, iCurrentResY);
+
         // Cutscene FOV
-        std::uint8_t* CutsceneFOVScanResult = Memory::PatternScan(exeModule, "83 ?? ?? ?? 02 0F 28 ?? 48 8B ?? ?? ?? 0F 57 ?? F3 0F ?? ?? F3 0F ?? ?? ?? ?? ?? ??");
+        std::uint8_t* CutsceneFOVScanResult = ScanResult(Sig::CutsceneFOV);
         if (CutsceneFOVScanResult) {
             spdlog::info("Cutscene FOV: Address is {:s}+{:x}", sExeName.c_str(), CutsceneFOVScanResult - (std::uint8_t*)exeModule);
+            Memory::PatchTransaction CutsceneFOVPatches;
             static SafetyHookMid CutsceneFOVMidHook{};
-            CutsceneFOVMidHook = safetyhook::create_mid(CutsceneFOVScanResult + 0x8,
+            CutsceneFOVPatches.MidHook(CutsceneFOVMidHook, CutsceneFOVScanResult,
                 [](SafetyHookContext& ctx) {
-                    // Check for "Fullscreen" picture framing option
-                    if (ctx.rax == 0) {
-                        // Get current resolution
-                        int iResX = (int)ctx.xmm1.f32[0];
-                        int iResY = (int)ctx.xmm2.f32[0];
-
-                        if (iResX != iCurrentResX || iResY != iCurrentResY) {
-                            iCurrentResX = iResX;
-                            iCurrentResY = iResY;
-                            CalculateAspectRatio(true);
-                        }
+                    Telemetry::Scope scope(CutsceneFOVProbe);
 
-                        if (fAspectRatio > fNativeAspect) {
-                            // Set ZF to jump over 16:9 FOV modification
-                            ctx.rflags |= (1ULL << 6);
+                    if (TrackCutscenes())
+                        OnCutsceneFrame();
 
-                            // Fix vert- FOV
-                            ctx.xmm3.f32[0] = atanf(tanf(ctx.xmm3.f32[0] * (fPi / 360)) / fNativeAspect * fAspectRatio) * (360 / fPi);
-                        }
+                    if (!bFixCutsceneFOV)
+                        return;
+
+                    bool bRecording = CutsceneFOVTrace.Active();
+                    HookTrace::Registers before{};
+                    if (bRecording)
+                        before = HookTrace::Capture(ctx);
+
+                    if (Hooks::CutsceneFOV(CutsceneFOVTransform, ctx)) {
+                        iCurrentResX = (int)ctx.xmm1.f32[0];
+                        iCurrentResY = (int)ctx.xmm2.f32[0];
+                        CalculateAspectRatio(false);
+                        spdlog_ratelimited(1000, info, "Current Resolution: Resolution changed to {:d}x{:d}, fAspectRatio: {}", iCurrentResX, iCurrentResY, CutsceneFOVTransform.AspectRatio());
                     }
-                });
+
+                    if (bRecording)
+                        CutsceneFOVTrace.Add(before, HookTrace::Capture(ctx));
+                }, "Cutscene FOV");
+            CommitPatches(CutsceneFOVPatches, "Cutscene FOV");
         }
         else {
             spdlog::error("Cutscene FOV: Pattern scan failed.");
@@ -372,61 +885,593 @@ void AspectRatioFOV()
     }
 }
 
+// Frame capture
+// The frame timing hook only records timestamps, this worker starts and stops captures and writes the reports.
+FrameCapture::Recorder FrameRecorder;
+
+void WriteFrameCapture(const std::vector<std::int64_t>& timestamps)
+{
+    LARGE_INTEGER frequency;
+    QueryPerformanceFrequency(&frequency);
+    auto frameTimes = FrameCapture::FrameTimesMs(timestamps, frequency.QuadPart);
+    auto summary = FrameCapture::Summarize(frameTimes);
+
+    SYSTEMTIME time;
+    GetLocalTime(&time);
+    std::string fileName = sExePath.string() + fmt::format("{}_Capture_{:04d}{:02d}{:02d}_{:02d}{:02d}{:02d}", sFixName, time.wYear, time.wMonth, time.wDay, time.wHour, time.wMinute, time.wSecond);
+    if (!FrameCapture::WriteCsv(fileName + ".csv", timestamps, frameTimes, frequency.QuadPart))
+        spdlog::error("Frame Capture: Failed to write {}.csv", fileName);
+
+    auto report = fmt::format("{} frames over {:.2f}s\nAverage: {:.2f}fps ({:.3f}ms)\n1% low: {:.2f}fps\n0.1% low: {:.2f}fps\nStutters: {}\n",
+        summary.frames, summary.durationMs / 1000.0, summary.averageFPS, summary.averageFrameMs, summary.onePercentLowFPS, summary.pointOnePercentLowFPS, summary.stutters);
+    std::ofstream summaryFile(fileName + ".txt", std::ios::trunc);
+    summaryFile << report;
+
+    spdlog::info("Frame Capture: Wrote {}.csv: {} frames, average {:.2f}fps, 1% low {:.2f}fps, 0.1% low {:.2f}fps, {} stutter(s).",
+        fileName, summary.frames, summary.averageFPS, summary.onePercentLowFPS, summary.pointOnePercentLowFPS, summary.stutters);
+}
+
+// Saves hook traces as they fill, until every one that's recording is full
+void HookTraceWorker()
+{
+    struct Trace
+    {
+        const HookTrace::Recorder& recorder;
+        const char* name;
+        std::size_t saved;
+    };
+    Trace traces[] = { { ReadOnlyCvarTrace, "ReadOnlyCvar", 0 }, { CutsceneFOVTrace, "CutsceneFOV", 0 } };
+
+    bool bRecording = true;
+    while (bRecording) {
+        std::this_thread::sleep_for(std::chrono::seconds(10));
+
+        bRecording = false;
+        for (auto& trace : traces) {
+            auto written = trace.recorder.Written();
+            if (written != trace.saved) {
+                auto path = sFixPath / (sFixName + "." + trace.name + ".hooktrace");
+                if (trace.recorder.Save(path)) {
+                    if (trace.recorder.Full())
+                        spdlog::info("Hook Trace: Saved {} call(s) to {}, recording finished.", written, path.string());
+                }
+                else {
+                    spdlog::error("Hook Trace: Failed to write {}.", path.string());
+                }
+                trace.saved = written;
+            }
+            bRecording |= (trace.recorder.Active() && !trace.recorder.Full()) || trace.saved != trace.recorder.Written();
+        }
+    }
+}
+
+void FrameCaptureWorker()
+{
+    int hotkey = 0;
+    try {
+        hotkey = std::stoi(sCaptureHotkey, nullptr, 0);
+    }
+    catch (const std::exception&) {
+        spdlog::error("Frame Capture: Invalid hotkey \"{}\".", sCaptureHotkey);
+        return;
+    }
+
+    // Hotkey toggles a capture, Cutscene captures each cutscene. Duration (if set) stops a capture early.
+    bool bCutsceneTrigger = sCaptureTrigger == "Cutscene";
+    bool bHotkeyDown = false;
+    bool bCapturing = false;
+    bool bCutsceneCaptured = false;
+    auto captureStart = std::chrono::steady_clock::now();
+    while (true) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+
+        bool bWantCapture;
+        if (bCutsceneTrigger) {
+            if (!bInCutscene)
+                bCutsceneCaptured = false;
+            bWantCapture = bInCutscene && !bCutsceneCaptured;
+        }
+        else {
+            bool bDown = (GetAsyncKeyState(hotkey) & 0x8000) != 0;
+            bWantCapture = (bDown && !bHotkeyDown) ? !bCapturing : bCapturing;
+            bHotkeyDown = bDown;
+        }
+
+        auto now = std::chrono::steady_clock::now();
+        if (bCapturing && iCaptureDuration > 0 && now - captureStart >= std::chrono::seconds(iCaptureDuration)) {
+            bWantCapture = false;
+            bCutsceneCaptured = true;
+        }
+
+        if (bWantCapture && !bCapturing) {
+            FrameRecorder.Start();
+            bCapturing = true;
+            captureStart = now;
+            spdlog::info("Frame Capture: Started capture.");
+        }
+        else if (!bWantCapture && bCapturing) {
+            auto timestamps = FrameRecorder.Stop();
+            bCapturing = false;
+            spdlog::info("Frame Capture: Stopped capture after {} frames.", timestamps.size());
+            WriteFrameCapture(timestamps);
+        }
+    }
+}
+
+// Clock for the frame limiter's pacer
+class WaitableTimerClock
+{
+public:
+    WaitableTimerClock()
+    {
+        QueryPerformanceFrequency(&frequency);
+        // High resolution timers need Windows 10 1803, fall back to a normal one
+        timer = CreateWaitableTimerExW(nullptr, nullptr, CREATE_WAITABLE_TIMER_HIGH_RESOLUTION, TIMER_ALL_ACCESS);
+        if (!timer)
+            timer = CreateWaitableTimerExW(nullptr, nullptr, 0, TIMER_ALL_ACCESS);
+    }
+
+    ~WaitableTimerClock()
+    {
+        if (timer)
+            CloseHandle(timer);
+    }
+
+    double Now() const
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return (double)now.QuadPart * 1000.0 / (double)frequency.QuadPart;
+    }
+
+    void Sleep(double ms)
+    {
+        // Relative due time, in 100ns units
+        LARGE_INTEGER dueTime;
+        dueTime.QuadPart = -(LONGLONG)(ms * 10000.0);
+        if (timer && SetWaitableTimerEx(timer, &dueTime, 0, nullptr, nullptr, nullptr, 0))
+            WaitForSingleObject(timer, INFINITE);
+        else
+            ::Sleep((DWORD)ms);
+    }
+
+    void Spin() const
+    {
+        YieldProcessor();
+    }
+
+private:
+    LARGE_INTEGER frequency;
+    HANDLE timer = nullptr;
+};
+
+// Called from the present hook on the render thread, or from the frame timing hook on the game thread until present is
+// called through the hooks, so the lock is only contended while pacing hands over from one to the other.
+std::mutex PacerMutex;
+
+// Waits until the next frame is due
+
+void PaceFrame()
+{
+    std::scoped_lock lock(PacerMutex);
+    static WaitableTimerClock clock;
+    static Pacing::Pacer<WaitableTimerClock> pacer(clock, [] {
+        Pacing::Settings settings;
+        settings.targetFrameMs = 1000.0 / std::max(fFrameLimiterFPS, 1.0f);
+        return settings;
+    }());
+    pacer.Wait();
+}
+
+using vkQueuePresentKHR_t = std::int32_t(*)(void* queue, const void* presentInfo);
+using vkGetProcAddr_t = void* (*)(void* handle, const char* name);
+std::atomic<vkQueuePresentKHR_t> vkQueuePresentKHR_fn = nullptr;
+std::atomic<vkGetProcAddr_t> vkGetDeviceProcAddr_fn = nullptr;
+std::atomic<vkGetProcAddr_t> vkGetInstanceProcAddr_fn = nullptr;
+
+Timeline::Milestone FirstPresent("First call", "vkQueuePresentKHR");
+std::atomic<bool> bPresentCalled = false;
+bool bPresentHooked = false;
+
+// Frames the frame timing hook waits for present to be called before pacing itself
+constexpr int PresentFallbackFrames = 120;
+
+std::int32_t vkQueuePresentKHR_Hook(void* queue, const void* presentInfo)
+{
+    FirstPresent.Hit();
+    if (!bPresentCalled.load(std::memory_order_relaxed))
+        bPresentCalled.store(true, std::memory_order_relaxed);
+    PaceFrame();
+    return vkQueuePresentKHR_fn.load()(queue, presentInfo);
+}
+
+void* vkGetDeviceProcAddr_Hook(void* device, const char* name);
+void* vkGetInstanceProcAddr_Hook(void* instance, const char* name);
+
+// Vulkan functions are normally looked up rather than imported, so hand out the present hook from the lookups, along with
+// hooked lookups for whatever gets looked up through them
+void* WrapVulkanFunction(void* function, const char* name)
+{
+    if (!function || !name)
+        return function;
+
+    if (std::strcmp(name, "vkQueuePresentKHR") == 0) {
+        vkQueuePresentKHR_fn = reinterpret_cast<vkQueuePresentKHR_t>(function);
+        return reinterpret_cast<void*>(vkQueuePresentKHR_Hook);
+    }
+    if (std::strcmp(name, "vkGetDeviceProcAddr") == 0) {
+        vkGetDeviceProcAddr_fn = reinterpret_cast<vkGetProcAddr_t>(function);
+        return reinterpret_cast<void*>(vkGetDeviceProcAddr_Hook);
+    }
+    if (std::strcmp(name, "vkGetInstanceProcAddr") == 0) {
+        vkGetInstanceProcAddr_fn = reinterpret_cast<vkGetProcAddr_t>(function);
+        return reinterpret_cast<void*>(vkGetInstanceProcAddr_Hook);
+    }
+    return function;
+}
+
+void* vkGetDeviceProcAddr_Hook(void* device, const char* name)
+{
+    return WrapVulkanFunction(vkGetDeviceProcAddr_fn.load()(device, name), name);
+}
+
+void* vkGetInstanceProcAddr_Hook(void* instance, const char* name)
+{
+    return WrapVulkanFunction(vkGetInstanceProcAddr_fn.load()(instance, name), name);
+}
+
+// Hooks present and the Vulkan lookups through the exe's imports. Returns false if it doesn't import anything usable.
+bool HookPresent()
+{
+    auto& imports = Memory::Imports(exeModule);
+    bool hooked = false;
+
+    auto hook = [&](const char* function, auto& original, auto detour) {
+        auto thunk = imports.Find("vulkan-1.dll", function);
+        if (!thunk || !*thunk)
+            return;
+        // Set before the thunk is swapped, the hook can be called straight away
+        original = reinterpret_cast<decltype(original.load())>(*thunk);
+        if (imports.Hook("vulkan-1.dll", thunk, reinterpret_cast<void*>(detour)))
+            hooked = true;
+    };
+    hook("vkQueuePresentKHR", vkQueuePresentKHR_fn, vkQueuePresentKHR_Hook);
+    hook("vkGetDeviceProcAddr", vkGetDeviceProcAddr_fn, vkGetDeviceProcAddr_Hook);
+    hook("vkGetInstanceProcAddr", vkGetInstanceProcAddr_fn, vkGetInstanceProcAddr_Hook);
+    return hooked;
+}
+
+using Sleep_t = void(WINAPI*)(DWORD ms);
+std::atomic<Sleep_t> Sleep_fn = nullptr;
+
+// The engine's own sleeps wake on the system timer and can oversleep by a timer tick or more, which the pacer then has to
+// absorb. Sleeps of a millisecond or more wait on a high resolution timer instead, one per thread that sleeps.
+void WINAPI Sleep_Hook(DWORD ms)
+{
+    if (ms == 0 || ms == INFINITE)
+        return Sleep_fn.load()(ms);
+
+    thread_local WaitableTimerClock clock;
+    clock.Sleep((double)ms);
+}
+
+// Hooks the exe's Sleep import, so the engine's timing is as precise as the pacer's
+bool HookSleep()
+{
+    auto& imports = Memory::Imports(exeModule);
+    auto thunk = imports.Find("kernel32.dll", "Sleep");
+    if (!thunk || !*thunk)
+        return false;
+    Sleep_fn = reinterpret_cast<Sleep_t>(*thunk);
+    return imports.Hook("kernel32.dll", thunk, reinterpret_cast<void*>(Sleep_Hook)) != nullptr;
+}
+
+// Game thread only. Paces on the frame timing hook if present couldn't be hooked, or hasn't been called through the hooks
+// after PresentFallbackFrames, until it is.
+void PaceFrameTiming()
+{
+    static int framesWithoutPresent = 0;
+    if (bPresentCalled.load(std::memory_order_relaxed))
+        return;
+
+    if (bPresentHooked && framesWithoutPresent < PresentFallbackFrames) {
+        if (++framesWithoutPresent < PresentFallbackFrames)
+            return;
+        spdlog::warn("Frame Limiter: vkQueuePresentKHR wasn't called through the hooks in {} frames, limiting framerate on the frame timing hook instead.", PresentFallbackFrames);
+    }
+    PaceFrame();
+}
+
+Commands::SharedRing* CommandRing = nullptr;
+// Cvars from the command channel, reused for every batch so draining the ring doesn't allocate
+CVarList CommandCVars;
+
+// Applies cvar batches sent by external tools, a bounded number per frame. Only called on the game thread.
+void DrainCommands()
+{
+    // Left queued until the command system is up
+    if (!FlushQueuedCVars())
+        return;
+
+    static Commands::Reader reader(*CommandRing);
+    CommandCVars.Clear();
+    auto result = reader.Drain((std::size_t)std::max(iCommandChannelBudget, 1), CommandCVars);
+    if (result.resynchronised)
+        spdlog::warn("Command Channel: The ring was left in an invalid state by a client, dropped its contents.");
+    if (!result.batches)
+        return;
+
+    spdlog::info("Command Channel: Applying {} cvar batch(es).", result.batches);
+    ApplyCVars(CommandCVars.Records());
+}
+
 void Framerate()
 {
     if (bCutsceneFrameGeneration) {
         // Allow framegen during midnight cutscenes
-        std::uint8_t* CutsceneFrameGenScanResult = Memory::PatternScan(exeModule, "38 5F 5B 0F 85 ?? ?? ?? ?? 48");
-        if (CutsceneFrameGenScanResult) {
-            spdlog::info("Cutscene Frame Generation: Address is {:s}+{:x}", sExeName.c_str(), CutsceneFrameGenScanResult - (std::uint8_t*)exeModule);
-            Memory::Write(CutsceneFrameGenScanResult + 0x5, (int)0);
+        Memory::PatchTransaction FrameGenPatches;
+        if (PatchScanResult(FrameGenPatches, Sig::CutsceneFrameGen, "Cutscene Frame Generation") && CommitPatches(FrameGenPatches, "Cutscene Frame Generation")) {
             spdlog::info("Cutscene Frame Generation: Enabled cutscene frame generation.");
         }
         else {
-            // Code changes in Update 3
-            CutsceneFrameGenScanResult = Memory::PatternScan(exeModule, "38 9F 87 00 00 00 0F 85 ?? ?? ?? ?? 48");
-            if (CutsceneFrameGenScanResult) {
-                spdlog::info("Cutscene Frame Generation (Upd3): Address is {:s}+{:x}", sExeName.c_str(), CutsceneFrameGenScanResult - (std::uint8_t*)exeModule);
-                Memory::Write(CutsceneFrameGenScanResult + 0x8, (int)0);
-                spdlog::info("Cutscene Frame Generation (Upd3): Enabled cutscene frame generation.");
-            }
-            else {
-                spdlog::error("Cutscene Frame Generation: Pattern scan failed.");
-            }
+            spdlog::error("Cutscene Frame Generation: Pattern scan failed.");
         }
     }
 
+    // The framerate unlock patch and frame timing hook go in together, since the hook relocates the
+    // patched bytes
+    Memory::PatchTransaction FrameratePatches;
     if (bCutsceneFramerateUnlock) {
         // Ignore cutscene timings and always use actual game timing
-        std::uint8_t* CutsceneFramerateScanResult = Memory::PatternScan(exeModule, "48 8B 41 28 48 8B 90 08 03 00 00");
-        if (CutsceneFramerateScanResult) {
-            spdlog::info("Cutscene Framerate Unlock: Address is {:s}+{:x}", sExeName.c_str(), CutsceneFramerateScanResult - (std::uint8_t*)exeModule);
-            Memory::PatchBytes(CutsceneFramerateScanResult + 0x4, "\x48\x31\xD2\x90\x90\x90\x90", 7);
+        if (PatchScanResult(FrameratePatches, Sig::CutsceneFramerate, "Cutscene Framerate Unlock")) {
             spdlog::info("Cutscene Framerate Unlock: Enabled framerate unlock.");
         }
         else {
-            // Update 2 added extra checks around where we patch, check for those separately
-            CutsceneFramerateScanResult = Memory::PatternScan(exeModule, "48 8B 41 28 48 39 98 08 03 00 00 75 1C");
-            if (CutsceneFramerateScanResult) {
-                spdlog::info("Cutscene Framerate Unlock (Upd2): Address is {:s}+{:x}", sExeName.c_str(), CutsceneFramerateScanResult - (std::uint8_t*)exeModule);
-                Memory::PatchBytes(CutsceneFramerateScanResult + 0xB, "\x90\x90", 2);
-                spdlog::info("Cutscene Framerate Unlock (Upd2): Enabled framerate unlock.");
-            }
-            else {
-                spdlog::error("Cutscene Framerate Unlock: Pattern scan failed.");
+            spdlog::error("Cutscene Framerate Unlock: Pattern scan failed.");
+        }
+    }
+
+    // Frame limiter, paced right before present where possible so frame generation and cutscenes are covered too
+    if (bFrameLimiter) {
+        bPresentHooked = HookPresent();
+        if (bPresentHooked) {
+            spdlog::info("Frame Limiter: Limiting framerate to {} on vkQueuePresentKHR once it's called through the hooked Vulkan imports.", fFrameLimiterFPS);
+        }
+        else {
+            spdlog::info("Frame Limiter: No Vulkan imports found, limiting framerate to {} on the frame timing hook.", fFrameLimiterFPS);
+        }
+        if (HookSleep()) {
+            spdlog::info("Frame Limiter: Hooked Sleep, engine sleeps use a high resolution timer.");
+        }
+    }
+
+    // Frame timing, the per-frame tick on the game thread, only hooked for features that need it: the quality governor,
+    // frame captures, the frame limiter fallback, the command channel and cutscene profiles. Without it, cvars queued before
+    // the command system was up are applied by the LevelLoadCompleted hook.
+    bool bGovernor = bQualityGovernor && !GovernorLevels.empty();
+    if (bGovernor || bFrameCapture || bFrameLimiter || CommandRing || TrackCutscenes()) {
+        // Installed after the framerate unlock patch, which the hook relocates
+        std::uint8_t* FrameTimingScanResult = ScanResult(Sig::FrameTiming);
+        if (FrameTimingScanResult) {
+            spdlog::info("Frame Timing: Address is {:s}+{:x}", sExeName.c_str(), FrameTimingScanResult - (std::uint8_t*)exeModule);
+
+            Governor::Settings settings;
+            settings.targetFrameMs = 1000.0f / std::max(fGovernorTargetFPS, 1.0f);
+            static Governor::Controller QualityGovernor(settings, bGovernor ? GovernorLevels.size() - 1 : 0);
+
+            static SafetyHookMid FrameTimingMidHook{};
+            FrameratePatches.MidHook(FrameTimingMidHook, FrameTimingScanResult,
+                [](SafetyHookContext& ctx) {
+                    Telemetry::Scope scope(FrameTimingProbe);
+
+                    // Only runs on the game thread, once per frame
+                    FlushQueuedCVars();
+
+                    if (bFrameLimiter)
+                        PaceFrameTiming();
+
+                    if (CommandRing)
+                        DrainCommands();
+
+                    if (TrackCutscenes())
+                        UpdateCutsceneState();
+
+                    static LARGE_INTEGER frequency = [] { LARGE_INTEGER f; QueryPerformanceFrequency(&f); return f; }();
+                    static LARGE_INTEGER lastFrame{};
+                    LARGE_INTEGER now;
+                    QueryPerformanceCounter(&now);
+
+                    if (bFrameCapture)
+                        FrameRecorder.OnFrame(now.QuadPart);
+
+                    if (bQualityGovernor && !GovernorLevels.empty() && lastFrame.QuadPart) {
+                        float frameMs = (float)((double)(now.QuadPart - lastFrame.QuadPart) * 1000.0 / (double)frequency.QuadPart);
+                        if (auto level = QualityGovernor.AddFrame(frameMs)) {
+                            spdlog::info("Quality Governor: Switching to quality level {} of {}.", *level, QualityGovernor.MaxLevel());
+                            SetCVars(GovernorLevels[*level].Records());
+                        }
+                    }
+                    lastFrame = now;
+                }, "Frame Timing");
+        }
+        else {
+            spdlog::error("Frame Timing: Pattern scan failed.");
+        }
+    }
+
+    if (CommitPatches(FrameratePatches, "Framerate") && bFrameCapture && FrameratePatches.HookCount())
+        std::thread(FrameCaptureWorker).detach();
+}
+
+void SuggestSignatures()
+{
+    Timeline::Span span("Startup", "Signature suggestions");
+
+    // Look for near matches of every fix that wasn't found, in case a game update only changed a few bytes
+    auto regions = Memory::GetScanRegions(exeModule, Memory::ScanScope::Code);
+    for (std::size_t i = 0; i < (std::size_t)Sig::Count; ++i) {
+        if (ScanResults[i].address)
+            continue;
+
+        for (const auto& variant : SignatureTable) {
+            if ((std::size_t)variant.sig != i)
+                continue;
+
+            std::string name = SignatureNames[i];
+            if (variant.version)
+                name += std::string(" (") + variant.version + ")";
+
+            // Allow up to a quarter of the fixed bytes to differ
+            auto fixedBytes = std::count(variant.signature.mask.begin(), variant.signature.mask.begin() + variant.signature.length, 0xFF);
+            auto matches = Memory::FindApproximate(regions, variant.signature, std::max<std::size_t>(fixedBytes / 4, 1), 3);
+            for (const auto& match : matches) {
+                spdlog::warn("Pattern Scan: {:s}: Near match at {:s}+{:x} with {} byte(s) different. Suggested signature: {:s}", name, sExeName.c_str(),
+                    match.address - (std::uint8_t*)exeModule, match.mismatches, Memory::SuggestSignature(variant.signature, match.address));
             }
+            if (matches.empty())
+                spdlog::warn("Pattern Scan: {:s}: No near matches.", name);
         }
     }
 }
 
+Memory::CodeIndex CodeIndex;
+
+void BuildCodeIndex()
+{
+    Timeline::Span span("Startup", "Code index");
+
+    auto start = std::chrono::high_resolution_clock::now();
+    if (!CodeIndex.Build(exeModule)) {
+        spdlog::error("Code Index: No code sections found.");
+        return;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::high_resolution_clock::now() - start);
+    spdlog::info("Code Index: Indexed {} function(s), {} call(s) and {} data reference(s) in {}ms.", CodeIndex.FunctionCount(), CodeIndex.CallCount(), CodeIndex.DataReferenceCount(), elapsed.count());
+
+    // Where each signature landed, to help find new signatures after a game update
+    for (std::size_t i = 0; i < (std::size_t)Sig::Count; ++i) {
+        if (auto address = ScanResults[i].address) {
+            if (auto function = CodeIndex.FunctionContaining(address))
+                spdlog::info("Code Index: {:s} is at {:s}+{:x}, in the function at {:s}+{:x}.", SignatureNames[i], sExeName.c_str(), address - (std::uint8_t*)exeModule, sExeName.c_str(), function - (std::uint8_t*)exeModule);
+        }
+    }
+
+    // Cross-check the signatures that locate a function and an object directly
+    if (auto SetCVar = ScanResult(Sig::SetCVar)) {
+        if (CodeIndex.IsFunctionStart(SetCVar))
+            spdlog::info("Code Index: SetCVar is called from {} place(s).", CodeIndex.Callers(SetCVar).size());
+        else
+            spdlog::warn("Code Index: The SetCVar signature doesn't match the start of a function, it may be out of date.");
+    }
+
+    std::uint8_t* cmdSystem;
+    {
+        std::scoped_lock lock(CmdSystemMutex);
+        cmdSystem = idCmdSystemLocal;
+    }
+    if (cmdSystem)
+        spdlog::info("Code Index: idCmdSystemLocal is referenced from {} place(s).", CodeIndex.References(cmdSystem).size());
+}
+
+Modules::Watcher ModuleWatcher;
+
+// Modules the game may load later. Their versions are logged for writing [Module Patches].
+constexpr std::array<const wchar_t*, 5> WatchedModules = {
+    L"sl.interposer.dll",
+    L"sl.dlss.dll",
+    L"sl.dlss_g.dll",
+    L"nvngx_dlss.dll",
+    L"nvngx_dlssg.dll"
+};
+
+void WatchModules()
+{
+    for (auto moduleName : WatchedModules) {
+        ModuleWatcher.OnLoad(moduleName, {}, [moduleName](HMODULE module, const std::vector<std::uint8_t*>&, Modules::Patched) {
+            spdlog::info("Module Watch: {:s} loaded at {:x}, timestamp {:d}.", Util::wstring_to_string(moduleName), (uintptr_t)module, Memory::ModuleTimestamp(module));
+        });
+    }
+
+    for (const auto& patch : ModulePatches) {
+        Modules::BytePatch bytes{ 0, std::vector<std::uint8_t>(patch.bytes.bytes.begin(), patch.bytes.bytes.begin() + patch.bytes.length) };
+        ModuleWatcher.OnLoad(std::wstring(patch.moduleName.begin(), patch.moduleName.end()), { patch.signature }, { bytes },
+            [name = patch.name, moduleName = patch.moduleName](HMODULE module, const std::vector<std::uint8_t*>& results, Modules::Patched patched) {
+                if (!results[0])
+                    spdlog::error("Module Patches: {}: Pattern scan failed in {:s}.", name, moduleName);
+                else if (patched == Modules::Patched::AtLoad)
+                    spdlog::info("Module Patches: {}: Patched {:s}+{:x} as it loaded.", name, moduleName, results[0] - (std::uint8_t*)module);
+                else if (patched == Modules::Patched::AfterLoad)
+                    spdlog::info("Module Patches: {}: Patched {:s}+{:x} after it loaded.", name, moduleName, results[0] - (std::uint8_t*)module);
+                else
+                    spdlog::error("Module Patches: {}: Failed to write to {:s}+{:x}.", name, moduleName, results[0] - (std::uint8_t*)module);
+            });
+    }
+
+    if (!ModuleWatcher.Start(sFixPath, std::wstring(sFixName.begin(), sFixName.end())))
+        spdlog::error("Module Watch: Failed to register for DLL load notifications.");
+}
+
 DWORD __stdcall Main(void*)
 {
+    Timeline::Mark("Startup", "Main thread started");
     Logging();
     Configuration();
-    SkipIntro();
-    CVars();
-    AspectRatioFOV();
-    Framerate();
+
+    if (bTelemetry)
+        Telemetry::Start(std::chrono::seconds(std::max(iTelemetryLogInterval, 1)), L"Local\\" + std::wstring(sFixName.begin(), sFixName.end()) + L".Telemetry");
+
+    // Created before any hooks, so the frame timing hook knows whether to drain it
+    if (bCommandChannel) {
+        std::wstring name = L"Local\\" + std::wstring(sFixName.begin(), sFixName.end()) + L".Commands";
+        CommandRing = Commands::CreateSharedRing(name);
+        if (CommandRing) {
+            CommandCVars.Reserve(Commands::RingSlots, Commands::RingSlots * (sizeof(Commands::Command::name) + sizeof(Commands::Command::value) + 2));
+            spdlog::info("Command Channel: Listening on \"{}\".", Util::wstring_to_string(name));
+        }
+        else {
+            spdlog::error("Command Channel: Failed to create shared memory command ring.");
+        }
+    }
+
+    // Secondary modules are scanned when they load, on their own thread
+    WatchModules();
+
+    // Everything after config is a graph of tasks. Each fix scans for its own signatures and installs itself on its own lane,
+    // so a slow step (eg. a scan falling back to every signature variant) only holds up that fix.
+    // Skip intro is on the critical lane so its hook lands before the intro video starts.
+    Tasks::TaskGraph tasks;
+    std::size_t lanes = 0;
+    auto AddLane = [&tasks, &lanes](const char* scanName, const char* name, std::vector<Sig> sigs, void (*install)(), bool critical = false) {
+        auto scan = tasks.Add(scanName, [sigs = std::move(sigs)] { ScanSignatures(sigs); }, {}, critical);
+        tasks.Add(name, install, { scan }, critical);
+        ++lanes;
+    };
+    AddLane("Scan: Skip Intro", "Skip Intro", { Sig::SkipIntroVideo }, SkipIntro, true);
+    AddLane("Scan: CVars", "CVars", { Sig::ConsoleCVarRestrictions, Sig::BindCVarRestrictions, Sig::ExecCVarRestrictions, Sig::ReadOnlyCvar }, CVars);
+    AddLane("Scan: idCmdSystemLocal", "idCmdSystemLocal", { Sig::idCmdSystem }, CmdSystem);
+    AddLane("Scan: LevelLoadCompleted", "LevelLoadCompleted", { Sig::SetCVar, Sig::LevelLoadCompleted }, LevelLoadCompleted);
+    AddLane("Scan: Aspect Ratio/FOV", "Aspect Ratio/FOV", { Sig::CutsceneFOV }, AspectRatioFOV);
+    AddLane("Scan: Framerate", "Framerate", { Sig::CutsceneFrameGen, Sig::CutsceneFramerate, Sig::FrameTiming }, Framerate);
+
+    // A worker per lane, so one that's stuck can't starve the others
+    tasks.Run(lanes);
+
+    Timeline::Mark("Startup", "Fixes live");
+
+    if (bHookTrace)
+        std::thread(HookTraceWorker).detach();
+
+    // Saved now, later events (eg. first calls of hooks) are added as they happen
+    if (bStartupTimeline)
+        Timeline::Write(sFixPath / (sFixName + ".timeline.json"), std::chrono::minutes(10));
+
+    // Both of these scan the whole exe again, so they're left until everything else is in place
+    if (std::any_of(ScanResults.begin(), ScanResults.end(), [](const SignatureMatch& match) { return !match.address; }))
+        SuggestSignatures();
+
+    if (bCodeIndex)
+        BuildCodeIndex();
+
     return true;
 }
 
@@ -434,6 +1479,8 @@ BOOL APIENTRY DllMain(HMODULE hModule, DWORD  ul_reason_for_call, LPVOID lpReser
 {
     switch (ul_reason_for_call) {
     case DLL_PROCESS_ATTACH: {
+        Timeline::Begin();
+        Timeline::Mark("Startup", "DllMain");
         thisModule = hModule;
         HANDLE mainHandle = CreateThread(NULL, 0, Main, 0, NULL, 0);
         if (mainHandle) {
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <array>
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <limits>
+
+namespace FOV
+{
+    constexpr float fPi = 3.1415926535f;
+
+    // Reference vert- to hor+ conversion of a horizontal FOV (degrees) authored for nativeAspect
+    inline float HorPlus(float fov, float aspectRatio, float nativeAspect)
+    {
+        return atanf(tanf(fov * (fPi / 360)) / nativeAspect * aspectRatio) * (360 / fPi);
+    }
+
+    // FOV transform for the per-frame cutscene FOV hook.
+    // Cutscene cameras hold the same FOV for many frames, so results are cached per input FOV for the current aspect ratio
+    // and the trig only runs when the camera FOV or the resolution changes. Cached values are bit-identical to HorPlus().
+    // Not thread-safe, only meant to be used from the render thread.
+    class CutsceneFOV
+    {
+    public:
+        explicit CutsceneFOV(float nativeAspect) : nativeAspect(nativeAspect)
+        {
+            Invalidate();
+        }
+
+        // Returns true if the resolution changed. Invalid resolutions keep the previous aspect ratio.
+        bool SetResolution(int resX, int resY)
+        {
+            if (resX == currentResX && resY == currentResY)
+                return false;
+
+            currentResX = resX;
+            currentResY = resY;
+            if (resX > 0 && resY > 0) {
+                float newAspect = (float)resX / (float)resY;
+                if (newAspect != aspectRatio) {
+                    aspectRatio = newAspect;
+                    Invalidate();
+                }
+            }
+            return true;
+        }
+
+        float AspectRatio() const { return aspectRatio; }
+
+        // Hor+ only needs applying when wider than native
+        bool NeedsFix() const { return aspectRatio > nativeAspect; }
+
+        float Transform(float fov)
+        {
+            auto key = std::bit_cast<std::uint32_t>(fov);
+            auto& entry = cache[((key * 0x9E3779B1u) >> 26) & (CacheSize - 1)];
+            if (entry.key != key) {
+                entry.key = key;
+                entry.value = HorPlus(fov, aspectRatio, nativeAspect);
+            }
+            return entry.value;
+        }
+
+    private:
+        static constexpr std::size_t CacheSize = 64;
+        static constexpr std::uint32_t EmptyKey = 0xFFFFFFFF;   // A NaN, which HorPlus() would map to NaN anyway
+
+        struct Entry
+        {
+            std::uint32_t key;
+            float value;
+        };
+
+        void Invalidate()
+        {
+            for (auto& entry : cache)
+                entry = { EmptyKey, std::numeric_limits<float>::quiet_NaN() };
+        }
+
+        float nativeAspect;
+        float aspectRatio = 0.0f;
+        int currentResX = 0;
+        int currentResY = 0;
+        std::array<Entry, CacheSize> cache{};
+    };
+}
@@ -0,0 +1,122 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <fstream>
+#include <memory>
+#include <string>
+#include <vector>
+
+// Frame-time capture for benchmarking.
+// The game thread only stores a timestamp per frame into a preallocated ring, everything else (starting, stopping,
+// building the report) happens on a worker thread. The ring keeps the latest Capacity frames if a capture runs longer.
+
+namespace FrameCapture
+{
+    class Recorder
+    {
+    public:
+        static constexpr std::size_t Capacity = 1 << 18;   // ~73 minutes at 60fps
+
+        // Game thread, once per frame
+        void OnFrame(std::int64_t timestamp)
+        {
+            if (!recording.load(std::memory_order_acquire))
+                return;
+
+            auto index = head.load(std::memory_order_relaxed);
+            timestamps[index & (Capacity - 1)] = timestamp;
+            head.store(index + 1, std::memory_order_release);
+        }
+
+        // Worker thread. The ring is allocated by the first capture, so it costs nothing unless used.
+        void Start()
+        {
+            if (!timestamps)
+                timestamps = std::make_unique<std::int64_t[]>(Capacity);
+            head.store(0, std::memory_order_relaxed);
+            recording.store(true, std::memory_order_release);
+        }
+
+        // Worker thread. Returns the captured timestamps, oldest first.
+        std::vector<std::int64_t> Stop()
+        {
+            recording.store(false, std::memory_order_release);
+
+            // A frame that saw recording just before it was cleared may still be storing, its slot is at the head
+            auto count = head.load(std::memory_order_acquire);
+            auto first = count > Capacity ? count - Capacity + 1 : 0;
+            std::vector<std::int64_t> frames;
+            frames.reserve(count - first);
+            for (auto i = first; i < count; ++i)
+                frames.push_back(timestamps[i & (Capacity - 1)]);
+            return frames;
+        }
+
+    private:
+        std::unique_ptr<std::int64_t[]> timestamps;
+        std::atomic<std::size_t> head = 0;
+        std::atomic<bool> recording = false;
+    };
+
+    struct Summary
+    {
+        std::size_t frames = 0;
+        double durationMs = 0.0;
+        double averageFPS = 0.0;
+        double averageFrameMs = 0.0;
+        double onePercentLowFPS = 0.0;      // Average framerate of the slowest 1% of frames
+        double pointOnePercentLowFPS = 0.0; // Average framerate of the slowest 0.1% of frames
+        std::size_t stutters = 0;           // Frames taking over twice the median frame time
+    };
+
+    std::vector<double> FrameTimesMs(const std::vector<std::int64_t>& timestamps, std::int64_t frequency)
+    {
+        std::vector<double> frameTimes;
+        for (std::size_t i = 1; i < timestamps.size(); ++i)
+            frameTimes.push_back((double)(timestamps[i] - timestamps[i - 1]) * 1000.0 / (double)frequency);
+        return frameTimes;
+    }
+
+    Summary Summarize(const std::vector<double>& frameTimes)
+    {
+        Summary summary;
+        summary.frames = frameTimes.size();
+        if (frameTimes.empty())
+            return summary;
+
+        for (auto frameMs : frameTimes)
+            summary.durationMs += frameMs;
+        summary.averageFrameMs = summary.durationMs / (double)frameTimes.size();
+        summary.averageFPS = 1000.0 / summary.averageFrameMs;
+
+        auto sorted = frameTimes;
+        std::sort(sorted.begin(), sorted.end(), std::greater<>());
+        auto LowFPS = [&sorted](double fraction) {
+            auto count = std::max<std::size_t>((std::size_t)((double)sorted.size() * fraction), 1);
+            double total = 0.0;
+            for (std::size_t i = 0; i < count; ++i)
+                total += sorted[i];
+            return 1000.0 / (total / (double)count);
+        };
+        summary.onePercentLowFPS = LowFPS(0.01);
+        summary.pointOnePercentLowFPS = LowFPS(0.001);
+
+        double median = sorted[sorted.size() / 2];
+        summary.stutters = (std::size_t)std::count_if(frameTimes.begin(), frameTimes.end(), [median](double frameMs) { return frameMs > median * 2.0; });
+        return summary;
+    }
+
+    bool WriteCsv(const std::string& fileName, const std::vector<std::int64_t>& timestamps, const std::vector<double>& frameTimes, std::int64_t frequency)
+    {
+        std::ofstream file(fileName, std::ios::trunc);
+        if (!file)
+            return false;
+
+        file << "Frame,TimeMs,FrameTimeMs\n";
+        for (std::size_t i = 0; i < frameTimes.size(); ++i)
+            file << i << "," << (double)(timestamps[i + 1] - timestamps[0]) * 1000.0 / (double)frequency << "," << frameTimes[i] << "\n";
+        return file.good();
+    }
+}
@@ -0,0 +1,80 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+#include <optional>
+
+// Frame-time driven quality governor.
+// Frame times are averaged over a window. When the average is over the target by more than the upper band, quality steps
+// down one level, and when it's under by more than the lower band it steps back up. Each change is followed by a cooldown
+// so the new level gets measured before the next decision. The gap between the bands is the hysteresis that keeps it
+// from oscillating between two levels.
+// This is only the control logic, with no game or Windows dependencies, so it can be run against recorded frame-time
+// traces (see tools/governorsim.cpp).
+
+namespace Governor
+{
+    struct Settings
+    {
+        float targetFrameMs = 1000.0f / 60.0f;
+        float upperBand = 0.10f;            // Step down when the average is this fraction over the target
+        float lowerBand = 0.25f;            // Step up when the average is this fraction under the target
+        std::size_t windowFrames = 60;      // Frames averaged for each decision
+        std::size_t cooldownFrames = 120;   // Frames ignored after a change
+        float hitchMs = 250.0f;             // Longer frames (loading, alt-tab) are skipped
+    };
+
+    class Controller
+    {
+    public:
+        // Levels run from 0 (full quality) to maxLevel (cheapest)
+        Controller(const Settings& settings, std::size_t maxLevel) : settings(settings), maxLevel(maxLevel)
+        {
+            this->settings.windowFrames = std::max<std::size_t>(this->settings.windowFrames, 1);
+        }
+
+        // Adds one frame time. Returns the new level if it changed.
+        std::optional<std::size_t> AddFrame(float frameMs)
+        {
+            if (!(frameMs > 0.0f) || frameMs >= settings.hitchMs)
+                return std::nullopt;
+
+            if (cooldown > 0) {
+                --cooldown;
+                return std::nullopt;
+            }
+
+            // A single slow frame shouldn't be able to drag the whole window over the band
+            windowTotal += std::min(frameMs, settings.targetFrameMs * 2.0f);
+            if (++windowCount < settings.windowFrames)
+                return std::nullopt;
+
+            float average = windowTotal / (float)windowCount;
+            windowTotal = 0.0f;
+            windowCount = 0;
+
+            std::size_t newLevel = level;
+            if (average > settings.targetFrameMs * (1.0f + settings.upperBand) && level < maxLevel)
+                ++newLevel;
+            else if (average < settings.targetFrameMs * (1.0f - settings.lowerBand) && level > 0)
+                --newLevel;
+            else
+                return std::nullopt;
+
+            level = newLevel;
+            cooldown = settings.cooldownFrames;
+            return level;
+        }
+
+        std::size_t Level() const { return level; }
+        std::size_t MaxLevel() const { return maxLevel; }
+
+    private:
+        Settings settings;
+        std::size_t maxLevel;
+        std::size_t level = 0;
+        std::size_t cooldown = 0;
+        std::size_t windowCount = 0;
+        float windowTotal = 0.0f;
+    };
+}
@@ -1,81 +1,12 @@
+#pragma once
+
 #include "stdafx.h"
+#include "scanner.hpp"
 
 namespace Memory
 {
-    template<typename T>
-    void Write(std::uint8_t* writeAddress, T value)
-    {
-        DWORD oldProtect;
-        VirtualProtect((LPVOID)(writeAddress), sizeof(T), PAGE_EXECUTE_WRITECOPY, &oldProtect);
-        *(reinterpret_cast<T*>(writeAddress)) = value;
-        VirtualProtect((LPVOID)(writeAddress), sizeof(T), oldProtect, &oldProtect);
-    }
-
-    void PatchBytes(std::uint8_t* address, const char* pattern, unsigned int numBytes)
-    {
-        DWORD oldProtect;
-        VirtualProtect((LPVOID)address, numBytes, PAGE_EXECUTE_READWRITE, &oldProtect);
-        memcpy((LPVOID)address, pattern, numBytes);
-        VirtualProtect((LPVOID)address, numBytes, oldProtect, &oldProtect);
-    }
-
-    std::vector<int> pattern_to_byte(const char* pattern)
-    {
-        auto bytes = std::vector<int>{};
-        auto start = const_cast<char*>(pattern);
-        auto end = const_cast<char*>(pattern) + strlen(pattern);
-
-        for (auto current = start; current < end; ++current) {
-            if (*current == '?') {
-                ++current;
-                if (*current == '?')
-                    ++current;
-                bytes.push_back(-1);
-            }
-            else {
-                bytes.push_back(strtoul(current, &current, 16));
-            }
-        }
-        return bytes;
-    }
-
-    std::uint8_t* PatternScan(void* module, const char* signature) 
-    {
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
-
-        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
-        auto patternBytes = pattern_to_byte(signature);
-        auto scanBytes = reinterpret_cast<std::uint8_t*>(module);
-
-        auto s = patternBytes.size();
-        auto d = patternBytes.data();
-
-        for (auto i = 0ul; i < sizeOfImage - s; ++i) {
-            bool found = true;
-            for (auto j = 0ul; j < s; ++j) {
-                if (scanBytes[i + j] != d[j] && d[j] != -1) {
-                    found = false;
-                    break;
-                }
-            }
-            if (found) {
-                return &scanBytes[i];
-            }
-        }
-
-        return nullptr;
-    }
-
-    std::uint8_t* MultiPatternScan(void* module, const std::vector<const char*>& signatures) 
-    {
-        for (const auto& signature : signatures) {
-            if (std::uint8_t* result = PatternScan(module, signature)) {
-                return result;
-            }
-        }
-        return nullptr;
-    }
+    // Patches are applied from several threads (see PatchTransaction and ImportIndex), don't let two on the same page race their protection changes
+    std::mutex PatchMutex;
 
     static HMODULE GetThisDllHandle()
     {
@@ -85,13 +16,6 @@ namespace Memory
         return len ? (HMODULE)info.AllocationBase : NULL;
     }
 
-    std::uint32_t ModuleTimestamp(void* module)
-    {
-        auto dosHeader = (PIMAGE_DOS_HEADER)module;
-        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
-        return ntHeaders->FileHeader.TimeDateStamp;
-    }
-
     std::uint8_t* GetAbsolute(std::uint8_t* address) noexcept
     {
         if (address == nullptr)
@@ -102,42 +26,6 @@ namespace Memory
 
         return absoluteAddress;
     }
-
-    BOOL HookIAT(HMODULE callerModule, char const* targetModule, const void* targetFunction, void* detourFunction)
-    {
-        auto* base = (uint8_t*)callerModule;
-        const auto* dos_header = (IMAGE_DOS_HEADER*)base;
-        const auto nt_headers = (IMAGE_NT_HEADERS*)(base + dos_header->e_lfanew);
-        const auto* imports = (IMAGE_IMPORT_DESCRIPTOR*)(base + nt_headers->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT].VirtualAddress);
-
-        for (int i = 0; imports[i].Characteristics; i++)
-        {
-            const char* name = (const char*)(base + imports[i].Name);
-            if (lstrcmpiA(name, targetModule) != 0)
-                continue;
-
-            void** thunk = (void**)(base + imports[i].FirstThunk);
-
-            for (; *thunk; thunk++)
-            {
-                const void* import = *thunk;
-
-                if (import != targetFunction)
-                    continue;
-
-                DWORD oldState;
-                if (!VirtualProtect(thunk, sizeof(void*), PAGE_READWRITE, &oldState))
-                    return FALSE;
-
-                *thunk = detourFunction;
-
-                VirtualProtect(thunk, sizeof(void*), oldState, &oldState);
-
-                return TRUE;
-            }
-        }
-        return FALSE;
-    }
 }
 
 namespace Util
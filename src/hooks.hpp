@@ -0,0 +1,41 @@
+#pragma once
+
+#include "fov.hpp"
+
+#include <cstdint>
+
+// What the mid hooks do to the registers, shared by the game and tools/hookreplay.cpp.
+// Context is SafetyHookContext in the game. The replayer uses a struct with the same member names, so a replayed trace runs
+// exactly this code. Anything with side effects outside the registers (logging, cvars, globals) stays in the hook itself.
+
+namespace Hooks
+{
+    // rax holds the flags of the cvar being set
+    template<typename Context>
+    void ReadOnlyCvar(Context& ctx)
+    {
+        // Clear read-only flag (bit 15)
+        ctx.rax &= ~(1 << 15);
+        // Clear command-line only flag (bit 14)
+        ctx.rax &= ~(1 << 14);
+    }
+
+    // rax is 0 with the "Fullscreen" picture framing option, xmm1/xmm2 hold the resolution and xmm3 the FOV.
+    // Returns true if the resolution changed.
+    template<typename Context>
+    bool CutsceneFOV(FOV::CutsceneFOV& transform, Context& ctx)
+    {
+        if (ctx.rax != 0)
+            return false;
+
+        bool resolutionChanged = transform.SetResolution((int)ctx.xmm1.f32[0], (int)ctx.xmm2.f32[0]);
+        if (transform.NeedsFix()) {
+            // Set ZF to jump over 16:9 FOV modification
+            ctx.rflags |= (1ULL << 6);
+
+            // Fix vert- FOV
+            ctx.xmm3.f32[0] = transform.Transform(ctx.xmm3.f32[0]);
+        }
+        return resolutionChanged;
+    }
+}
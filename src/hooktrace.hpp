@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <vector>
+
+// Traces of the registers each mid hook reads and writes, for replaying hooks outside the game (see tools/hookreplay.cpp).
+// A trace is a Header followed by one Record per call, holding the registers before and after the hook ran. Recording is
+// one atomic add and a 64 byte copy per call, into a buffer allocated up front. Calls past its capacity aren't recorded.
+
+namespace HookTrace
+{
+    constexpr std::uint32_t Magic = 0x52544B48;     // "HKTR"
+    constexpr std::uint32_t Version = 1;
+
+    enum class Hook : std::uint32_t
+    {
+        ReadOnlyCvar = 1,
+        CutsceneFOV = 2
+    };
+
+    struct Header
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        Hook hook;
+        std::uint32_t recordSize;
+        std::uint64_t recordCount;
+        float nativeAspect;     // Hook state when recording started
+        std::int32_t resX;
+        std::int32_t resY;
+        std::uint32_t reserved;
+    };
+
+    // Every register any hook uses. Only the low float of the xmm registers is used.
+    struct Registers
+    {
+        std::uint64_t rax;
+        std::uint64_t rflags;
+        float xmm1;
+        float xmm2;
+        float xmm3;
+        std::uint32_t reserved;
+    };
+
+    struct Record
+    {
+        Registers before;
+        Registers after;
+    };
+
+    static_assert(sizeof(Header) == 40);
+    static_assert(sizeof(Record) == 64);
+
+    template<typename Context>
+    Registers Capture(const Context& ctx)
+    {
+        return { ctx.rax, ctx.rflags, ctx.xmm1.f32[0], ctx.xmm2.f32[0], ctx.xmm3.f32[0], 0 };
+    }
+
+    template<typename Context>
+    void Restore(const Registers& registers, Context& ctx)
+    {
+        ctx.rax = registers.rax;
+        ctx.rflags = registers.rflags;
+        ctx.xmm1.f32[0] = registers.xmm1;
+        ctx.xmm2.f32[0] = registers.xmm2;
+        ctx.xmm3.f32[0] = registers.xmm3;
+    }
+
+    class Recorder
+    {
+    public:
+        explicit Recorder(Hook hook)
+        {
+            header = { Magic, Version, hook, sizeof(Record), 0, 0.0f, 0, 0, 0 };
+        }
+
+        // Must be called before the hook is installed
+        void Start(std::size_t capacity, float nativeAspect, int resX, int resY)
+        {
+            header.nativeAspect = nativeAspect;
+            header.resX = resX;
+            header.resY = resY;
+            records = std::make_unique<Record[]>(capacity);
+            ready = std::make_unique<std::atomic<bool>[]>(capacity);
+            this->capacity = capacity;
+            active.store(capacity != 0, std::memory_order_release);
+        }
+
+        bool Active() const { return active.load(std::memory_order_relaxed); }
+
+        void Add(const Registers& before, const Registers& after)
+        {
+            auto index = reserved.fetch_add(1, std::memory_order_relaxed);
+            if (index >= capacity) {
+                active.store(false, std::memory_order_relaxed);
+                return;
+            }
+
+            records[index] = { before, after };
+            ready[index].store(true, std::memory_order_release);
+
+            // Records [0, written) are complete
+            auto count = written.load(std::memory_order_acquire);
+            while (count < capacity && ready[count].load(std::memory_order_acquire)) {
+                if (written.compare_exchange_weak(count, count + 1, std::memory_order_acq_rel))
+                    ++count;
+            }
+        }
+
+        std::size_t Written() const { return written.load(std::memory_order_acquire); }
+        bool Full() const { return capacity && Written() >= capacity; }
+
+        // Saves every complete record so far, replacing the file
+        bool Save(const std::filesystem::path& path) const
+        {
+            Header saved = header;
+            saved.recordCount = Written();
+
+            std::ofstream file(path, std::ios::binary | std::ios::trunc);
+            file.write(reinterpret_cast<const char*>(&saved), sizeof(saved));
+            file.write(reinterpret_cast<const char*>(records.get()), (std::streamsize)(saved.recordCount * sizeof(Record)));
+            return file.good();
+        }
+
+    private:
+        Header header;
+        std::unique_ptr<Record[]> records;
+        std::unique_ptr<std::atomic<bool>[]> ready;
+        std::size_t capacity = 0;
+        std::atomic<bool> active = false;
+        std::atomic<std::size_t> reserved = 0;
+        std::atomic<std::size_t> written = 0;
+    };
+
+    // Loads a trace, returns false if it isn't one or is truncated
+    bool Load(const std::filesystem::path& path, Header& header, std::vector<Record>& records)
+    {
+        std::error_code error;
+        auto size = std::filesystem::file_size(path, error);
+        std::ifstream file(path, std::ios::binary);
+        if (error || !file || !file.read(reinterpret_cast<char*>(&header), sizeof(header)))
+            return false;
+        if (header.magic != Magic || header.version != Version || header.recordSize != sizeof(Record) || header.recordCount > (size - sizeof(header)) / sizeof(Record))
+            return false;
+
+        records.resize(header.recordCount);
+        return (bool)file.read(reinterpret_cast<char*>(records.data()), (std::streamsize)(records.size() * sizeof(Record)));
+    }
+}
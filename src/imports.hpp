@@ -0,0 +1,116 @@
+#pragma once
+
+#include "helper.hpp"
+
+#include <map>
+#include <memory>
+#include <string>
+#include <string_view>
+
+namespace Memory
+{
+    // Every import of a module, indexed by "module!function" and by the address each thunk currently points at.
+    // Built once per module by Imports(), so hooking any number of imports doesn't walk the import table each time.
+    class ImportIndex
+    {
+    public:
+        explicit ImportIndex(HMODULE module)
+        {
+            auto base = (std::uint8_t*)module;
+            auto dosHeader = (PIMAGE_DOS_HEADER)base;
+            auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+            const auto& directory = ntHeaders->OptionalHeader.DataDirectory[IMAGE_DIRECTORY_ENTRY_IMPORT];
+            if (!directory.VirtualAddress)
+                return;
+
+            for (auto descriptor = (const IMAGE_IMPORT_DESCRIPTOR*)(base + directory.VirtualAddress); descriptor->Characteristics || descriptor->FirstThunk; ++descriptor) {
+                std::string moduleName = Lowercase((const char*)(base + descriptor->Name));
+                auto thunk = (void**)(base + descriptor->FirstThunk);
+
+                // Names come from the lookup table, bound imports without one are only found by address
+                auto lookup = descriptor->OriginalFirstThunk ? (const IMAGE_THUNK_DATA*)(base + descriptor->OriginalFirstThunk) : nullptr;
+                for (; *thunk; ++thunk) {
+                    std::string functionName;
+                    if (lookup && lookup->u1.AddressOfData) {
+                        if (IMAGE_SNAP_BY_ORDINAL(lookup->u1.Ordinal))
+                            functionName = "#" + std::to_string(IMAGE_ORDINAL(lookup->u1.Ordinal));
+                        else
+                            functionName = ((const IMAGE_IMPORT_BY_NAME*)(base + lookup->u1.AddressOfData))->Name;
+                        ++lookup;
+                    }
+
+                    if (!functionName.empty())
+                        byName.try_emplace(moduleName + "!" + functionName, thunk);
+                    byAddress.try_emplace({ moduleName, *thunk }, thunk);
+                }
+            }
+        }
+
+        // The thunk for an import by name, eg. ("kernel32.dll", "Sleep"). Module names are case-insensitive.
+        void** Find(std::string_view module, std::string_view function) const
+        {
+            std::scoped_lock lock(mutex);
+            auto entry = byName.find(Lowercase(module) + "!" + std::string(function));
+            return entry != byName.end() ? entry->second : nullptr;
+        }
+
+        // The thunk from module that currently points at function
+        void** FindByAddress(std::string_view module, const void* function) const
+        {
+            std::scoped_lock lock(mutex);
+            auto entry = byAddress.find({ Lowercase(module), function });
+            return entry != byAddress.end() ? entry->second : nullptr;
+        }
+
+        // Points thunk at detour, returning what it pointed at before (or nullptr on failure)
+        void* Hook(std::string_view module, void** thunk, void* detour)
+        {
+            std::scoped_lock lock(mutex, PatchMutex);
+            DWORD oldProtect;
+            if (!thunk || !VirtualProtect(thunk, sizeof(void*), PAGE_READWRITE, &oldProtect))
+                return nullptr;
+
+            void* original = *thunk;
+            *thunk = detour;
+            VirtualProtect(thunk, sizeof(void*), oldProtect, &oldProtect);
+
+            auto moduleName = Lowercase(module);
+            byAddress.erase({ moduleName, original });
+            byAddress.try_emplace({ moduleName, detour }, thunk);
+            return original;
+        }
+
+        std::size_t Size() const { return byName.size(); }
+
+    private:
+        static std::string Lowercase(std::string_view text)
+        {
+            std::string lower(text);
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](unsigned char c) { return (char)std::tolower(c); });
+            return lower;
+        }
+
+        mutable std::mutex mutex;
+        std::unordered_map<std::string, void**> byName;
+        std::map<std::pair<std::string, const void*>, void**> byAddress;
+    };
+
+    // The import index of a module, built the first time it's asked for
+    ImportIndex& Imports(HMODULE module)
+    {
+        static std::mutex mutex;
+        static std::unordered_map<HMODULE, std::unique_ptr<ImportIndex>> indices;
+
+        std::scoped_lock lock(mutex);
+        auto& index = indices[module];
+        if (!index)
+            index = std::make_unique<ImportIndex>(module);
+        return *index;
+    }
+
+    BOOL HookIAT(HMODULE callerModule, char const* targetModule, const void* targetFunction, void* detourFunction)
+    {
+        auto& imports = Imports(callerModule);
+        return imports.Hook(targetModule, imports.FindByAddress(targetModule, targetFunction), detourFunction) != nullptr;
+    }
+}
@@ -0,0 +1,242 @@
+#pragma once
+
+#include <spdlog/spdlog.h>
+#include <spdlog/sinks/sink.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+
+namespace Log
+{
+    // Sink that queues log records in a bounded lock-free ring (many producers, one consumer) and writes them to the wrapped
+    // sink from a background thread. Logging from a hook is a copy into a ring slot, it never waits on disk I/O or a lock.
+    // If the ring is full the record is dropped and counted rather than blocking the game thread.
+    // The writer is only woken when it's asleep on an empty ring, or for warnings and above. Lines are flushed flushInterval
+    // after the first one that hasn't been, whether or not anything is logged after them.
+    class AsyncSink final : public spdlog::sinks::sink
+    {
+    public:
+        AsyncSink(spdlog::sink_ptr inner, std::chrono::milliseconds flushInterval) : inner(std::move(inner)), flushInterval(flushInterval)
+        {
+            for (std::size_t i = 0; i < Capacity; ++i)
+                slots[i].sequence.store(i, std::memory_order_relaxed);
+            writer = std::thread(&AsyncSink::Writer, this);
+        }
+
+        ~AsyncSink() override
+        {
+            stop = true;
+            Wake();
+            if (writer.joinable())
+                writer.join();
+        }
+
+        void log(const spdlog::details::log_msg& msg) override
+        {
+            // Claim a slot (Vyukov bounded queue, multi-producer side)
+            Slot* slot;
+            auto pos = enqueuePos.load(std::memory_order_relaxed);
+            while (true) {
+                slot = &slots[pos & (Capacity - 1)];
+                auto sequence = slot->sequence.load(std::memory_order_acquire);
+                auto diff = (std::intptr_t)sequence - (std::intptr_t)pos;
+                if (diff == 0) {
+                    if (enqueuePos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+                        break;
+                }
+                else if (diff < 0) {
+                    dropped.fetch_add(1, std::memory_order_relaxed);
+                    return;
+                }
+                else {
+                    pos = enqueuePos.load(std::memory_order_relaxed);
+                }
+            }
+
+            slot->time = msg.time;
+            slot->level = msg.level;
+            slot->threadId = msg.thread_id;
+            slot->loggerName = msg.logger_name;
+            slot->length = std::min(msg.payload.size(), sizeof(slot->text));
+            std::memcpy(slot->text, msg.payload.data(), slot->length);
+            slot->sequence.store(pos + 1, std::memory_order_release);
+
+            if (msg.level >= spdlog::level::err)
+                flushRequested.store(true, std::memory_order_relaxed);
+
+            // Pairs with the fence in Writer(), so either it sees this record or this sees it asleep
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (msg.level >= spdlog::level::warn || sleeping.load(std::memory_order_relaxed))
+                Wake();
+        }
+
+        // Called by spdlog's flush_on/flush_every, just asks the writer thread to flush
+        void flush() override
+        {
+            flushRequested.store(true, std::memory_order_relaxed);
+            Wake();
+        }
+
+        void set_pattern(const std::string& pattern) override
+        {
+            inner->set_pattern(pattern);
+        }
+
+        void set_formatter(std::unique_ptr<spdlog::formatter> sinkFormatter) override
+        {
+            inner->set_formatter(std::move(sinkFormatter));
+        }
+
+    private:
+        static constexpr std::size_t Capacity = 1024;
+
+        struct Slot
+        {
+            std::atomic<std::size_t> sequence;
+            spdlog::log_clock::time_point time;
+            spdlog::level::level_enum level;
+            std::size_t threadId;
+            spdlog::string_view_t loggerName;   // Points at the logger's name, which outlives the sink
+            std::size_t length;
+            char text[480];
+        };
+
+        // Taking the lock means the writer is either still awake or already waiting, so the notify can't be lost
+        void Wake()
+        {
+            {
+                std::scoped_lock lock(wakeMutex);
+                sleeping.store(false, std::memory_order_relaxed);
+            }
+            wake.notify_one();
+        }
+
+        // Single consumer side
+        bool Pending() const
+        {
+            return slots[dequeuePos & (Capacity - 1)].sequence.load(std::memory_order_acquire) == dequeuePos + 1;
+        }
+
+        bool Dequeue()
+        {
+            auto& slot = slots[dequeuePos & (Capacity - 1)];
+            if (slot.sequence.load(std::memory_order_acquire) != dequeuePos + 1)
+                return false;
+
+            spdlog::details::log_msg msg(slot.time, spdlog::source_loc{}, slot.loggerName, slot.level, spdlog::string_view_t(slot.text, slot.length));
+            msg.thread_id = slot.threadId;
+            inner->log(msg);
+            lastLoggerName = slot.loggerName;
+
+            slot.sequence.store(dequeuePos + Capacity, std::memory_order_release);
+            ++dequeuePos;
+            return true;
+        }
+
+        void Writer()
+        {
+            bool unflushed = false;
+            auto unflushedSince = std::chrono::steady_clock::now();
+            while (true) {
+                bool wrote = false;
+                while (Dequeue())
+                    wrote = true;
+
+                if (auto count = dropped.exchange(0, std::memory_order_relaxed)) {
+                    auto message = fmt::format("Log: Queue full, dropped {} message(s).", count);
+                    spdlog::details::log_msg msg(spdlog::source_loc{}, lastLoggerName, spdlog::level::warn, message);
+                    inner->log(msg);
+                    wrote = true;
+                }
+
+                auto now = std::chrono::steady_clock::now();
+                if (wrote && !unflushed) {
+                    unflushed = true;
+                    unflushedSince = now;
+                }
+                if (flushRequested.exchange(false, std::memory_order_relaxed) || (unflushed && now - unflushedSince >= flushInterval)) {
+                    inner->flush();
+                    unflushed = false;
+                }
+
+                if (stop) {
+                    while (Dequeue()) {}
+                    inner->flush();
+                    return;
+                }
+
+                std::unique_lock lock(wakeMutex);
+                sleeping.store(true, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (Pending() || stop || flushRequested.load(std::memory_order_relaxed)) {
+                    sleeping.store(false, std::memory_order_relaxed);
+                    continue;
+                }
+
+                // Times out when the oldest unflushed line is due to be flushed
+                if (unflushed)
+                    wake.wait_for(lock, flushInterval - (now - unflushedSince));
+                else
+                    wake.wait(lock);
+                sleeping.store(false, std::memory_order_relaxed);
+            }
+        }
+
+        spdlog::sink_ptr inner;
+        std::chrono::milliseconds flushInterval;
+        spdlog::string_view_t lastLoggerName;
+        Slot slots[Capacity];
+        alignas(64) std::atomic<std::size_t> enqueuePos = 0;
+        alignas(64) std::size_t dequeuePos = 0;
+        std::atomic<std::size_t> dropped = 0;
+        std::atomic<bool> flushRequested = false;
+        std::atomic<bool> stop = false;
+        std::atomic<bool> sleeping = false;
+        std::mutex wakeMutex;
+        std::condition_variable wake;
+        std::thread writer;
+    };
+
+    // Allows one log line per interval from a call site, and counts the ones it suppresses.
+    class RateLimiter
+    {
+    public:
+        explicit RateLimiter(std::int64_t intervalMs) : intervalMs(intervalMs) {}
+
+        // Returns -1 if this line should be skipped, otherwise how many were skipped since the last one
+        std::int64_t Allow()
+        {
+            auto now = std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+            auto next = nextAllowed.load(std::memory_order_relaxed);
+            if (now >= next && nextAllowed.compare_exchange_strong(next, now + intervalMs, std::memory_order_relaxed))
+                return suppressed.exchange(0, std::memory_order_relaxed);
+
+            suppressed.fetch_add(1, std::memory_order_relaxed);
+            return -1;
+        }
+
+    private:
+        std::int64_t intervalMs;
+        std::atomic<std::int64_t> nextAllowed = 0;
+        std::atomic<std::int64_t> suppressed = 0;
+    };
+}
+
+// Logs at most once every intervalMs from this call site. Meant for lines logged from hooks that can fire every frame.
+#define spdlog_ratelimited(intervalMs, level, ...)                                              \
+    do {                                                                                        \
+        static Log::RateLimiter rateLimiter_(intervalMs);                                       \
+        if (auto suppressed_ = rateLimiter_.Allow(); suppressed_ >= 0) {                        \
+            if (suppressed_ > 0)                                                                \
+                spdlog::level("Log: Suppressed {} similar message(s).", suppressed_);           \
+            spdlog::level(__VA_ARGS__);                                                         \
+        }                                                                                       \
+    } while (0)
@@ -0,0 +1,338 @@
+#pragma once
+
+#include "stdafx.h"
+#include "patch.hpp"
+#include "scanner.hpp"
+
+#include <atomic>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <cwctype>
+#include <functional>
+#include <string>
+#include <unordered_map>
+
+// Deferred scanning of modules the game loads after startup, eg. upscaler DLLs.
+// Signature sets are registered against a module name and scanned once that module is mapped, using the loader's DLL
+// notifications instead of polling. Modules that are never loaded cost nothing.
+// The load notification arrives under the loader lock, once the image is mapped but before its DllMain has run, so it does
+// no more than it has to: it matches the name against the watches (which are fixed once the watcher starts, so there's no
+// lock to take), and writes byte patches whose addresses were resolved by an earlier scan of the same module version, after
+// checking the signatures still match there. Nothing is allocated, logged or waited on.
+// A worker thread does everything else: it scans (saving the addresses to a cache file per module, for the next load to
+// patch straight away), writes any patches the notification couldn't through a PatchTransaction, and runs the callbacks.
+// So the first time a version of a module is seen, it's patched just after it loads rather than before any code runs.
+
+namespace Modules
+{
+    // bytes are written at the match of signatures[signature]
+    struct BytePatch
+    {
+        std::size_t signature;
+        std::vector<std::uint8_t> bytes;
+    };
+
+    enum class Patched
+    {
+        No,         // Nothing to patch, a signature wasn't found, or writing failed
+        AtLoad,     // By the load notification, before any of the module's code ran
+        AfterLoad   // By the worker, once the module was already loaded
+    };
+
+    using Callback = std::function<void(HMODULE module, const std::vector<std::uint8_t*>& results, Patched patched)>;
+
+    // Overwrites code in a module that hasn't run yet. Nothing can be executing it, so unlike Memory::PatchTransaction
+    // there are no threads to freeze, and it's safe under the loader lock.
+    bool WriteUnstarted(std::uint8_t* address, const void* bytes, std::size_t size)
+    {
+        DWORD oldProtect;
+        if (!VirtualProtect(address, size, PAGE_EXECUTE_READWRITE, &oldProtect))
+            return false;
+        std::memcpy(address, bytes, size);
+        VirtualProtect(address, size, oldProtect, &oldProtect);
+        FlushInstructionCache(GetCurrentProcess(), address, size);
+        return true;
+    }
+
+    class Watcher
+    {
+    public:
+        // Scans moduleName for signatures, writes patches and runs callback with the results, once every time it's loaded.
+        // If it's already loaded when the watcher starts, that happens straight away (on the worker thread).
+        // Every watch must be registered before Start().
+        void OnLoad(const std::wstring& moduleName, std::vector<Memory::Signature> signatures, std::vector<BytePatch> patches, Callback callback)
+        {
+            if (!started)
+                watches.emplace_back(Lowercase(moduleName), std::move(signatures), std::move(patches), std::move(callback));
+        }
+
+        void OnLoad(const std::wstring& moduleName, std::vector<Memory::Signature> signatures, Callback callback)
+        {
+            OnLoad(moduleName, std::move(signatures), {}, std::move(callback));
+        }
+
+        // Loads the addresses cached by earlier scans, registers for DLL notifications and starts the worker.
+        // Each module's cache is cacheDirectory/<cachePrefix>.<module name>.cache.
+        bool Start(const std::filesystem::path& cacheDirectory, const std::wstring& cachePrefix)
+        {
+            for (auto& watch : watches) {
+                watch.cacheFile = cacheDirectory / (cachePrefix + L"." + watch.name + L".cache");
+                LoadResolved(watch);
+            }
+
+            wakeEvent = CreateEventW(nullptr, FALSE, FALSE, nullptr);
+            auto ntdll = GetModuleHandleW(L"ntdll.dll");
+            auto LdrRegisterDllNotification = ntdll ? reinterpret_cast<LdrRegisterDllNotification_t>(GetProcAddress(ntdll, "LdrRegisterDllNotification")) : nullptr;
+            if (!wakeEvent || !LdrRegisterDllNotification)
+                return false;
+
+            started = true;
+            if (LdrRegisterDllNotification(0, Notification, this, &cookie) != 0)
+                return false;
+
+            std::thread([this] { Worker(); }).detach();
+            return true;
+        }
+
+    private:
+        struct UnicodeString
+        {
+            USHORT Length;
+            USHORT MaximumLength;
+            PWSTR Buffer;
+        };
+
+        struct NotificationData
+        {
+            ULONG Flags;
+            const UnicodeString* FullDllName;
+            const UnicodeString* BaseDllName;
+            PVOID DllBase;
+            ULONG SizeOfImage;
+        };
+
+        using LdrDllNotification_t = VOID(CALLBACK*)(ULONG reason, const NotificationData* data, PVOID context);
+        using LdrRegisterDllNotification_t = LONG(NTAPI*)(ULONG flags, LdrDllNotification_t callback, PVOID context, PVOID* cookie);
+
+        static constexpr ULONG ReasonLoaded = 1;
+        static constexpr ULONG ReasonUnloaded = 2;
+
+        struct Watch
+        {
+            Watch(std::wstring name, std::vector<Memory::Signature> signatures, std::vector<BytePatch> patches, Callback callback)
+                : name(std::move(name)), signatures(std::move(signatures)), patches(std::move(patches)), callback(std::move(callback)),
+                  resolvedRvas(this->signatures.size(), Memory::ScanCacheNotFound), loadResults(this->signatures.size(), nullptr) {}
+
+            std::wstring name;
+            std::vector<Memory::Signature> signatures;
+            std::vector<BytePatch> patches;
+            Callback callback;
+            std::filesystem::path cacheFile;
+
+            // Addresses from an earlier scan, for resolvedTimestamp's version of the module. Filled in before resolved is
+            // set and never changed after, so the notification can read them once it sees resolved.
+            std::atomic<bool> resolved = false;
+            std::uint32_t resolvedTimestamp = 0;
+            std::vector<std::uint32_t> resolvedRvas;
+
+            // Written by the load notification before it bumps loads. Read by the worker while it holds a reference to the
+            // module, so there can't be another load in between.
+            std::atomic<HMODULE> loaded = nullptr;
+            std::atomic<std::uint32_t> loads = 0;
+            std::vector<std::uint8_t*> loadResults;
+            bool patchedAtLoad = false;
+
+            // Worker only
+            std::uint32_t handledLoads = 0;
+            HMODULE handled = nullptr;
+        };
+
+        static std::wstring Lowercase(std::wstring_view text)
+        {
+            std::wstring lower(text);
+            std::transform(lower.begin(), lower.end(), lower.begin(), [](wchar_t c) { return (wchar_t)std::towlower(c); });
+            return lower;
+        }
+
+        // ASCII case folding only, so it's safe under the loader lock. Module names that matter here are ASCII.
+        static bool NameMatches(const std::wstring& lowercaseName, const UnicodeString* name)
+        {
+            std::size_t length = name->Length / sizeof(wchar_t);
+            if (length != lowercaseName.size())
+                return false;
+            for (std::size_t i = 0; i < length; ++i) {
+                wchar_t c = name->Buffer[i];
+                if (c >= L'A' && c <= L'Z')
+                    c += L'a' - L'A';
+                if (c != lowercaseName[i])
+                    return false;
+            }
+            return true;
+        }
+
+        // Worker only, before the addresses are published
+        void Resolve(Watch& watch, std::uint32_t timestamp, std::span<const std::uint32_t> rvas)
+        {
+            if (watch.resolved.load(std::memory_order_relaxed))
+                return;
+
+            // Only worth it if every patch's signature has an address
+            for (const auto& patch : watch.patches) {
+                if (patch.signature >= rvas.size() || rvas[patch.signature] == Memory::ScanCacheNotFound)
+                    return;
+            }
+            if (watch.patches.empty())
+                return;
+
+            watch.resolvedTimestamp = timestamp;
+            std::copy(rvas.begin(), rvas.end(), watch.resolvedRvas.begin());
+            watch.resolved.store(true, std::memory_order_release);
+        }
+
+        void LoadResolved(Watch& watch)
+        {
+            std::unordered_map<std::uint64_t, std::uint32_t> cache;
+            std::uint32_t timestamp;
+            {
+                std::scoped_lock lock(Memory::ScanCacheMutex);
+                timestamp = Memory::ReadScanCache(watch.cacheFile, cache);
+            }
+
+            std::vector<std::uint32_t> rvas;
+            for (const auto& signature : watch.signatures) {
+                auto entry = cache.find(Memory::SignatureHash(signature, Memory::ScanScope::Code));
+                rvas.push_back(entry != cache.end() ? entry->second : Memory::ScanCacheNotFound);
+            }
+            if (timestamp)
+                Resolve(watch, timestamp, rvas);
+        }
+
+        // Under the loader lock. Writes the patches if every address resolved for this version of the module still matches.
+        static bool PatchAtLoad(Watch& watch, std::uint8_t* base, std::size_t sizeOfImage)
+        {
+            if (!watch.resolved.load(std::memory_order_acquire) || Memory::ModuleTimestamp(base) != watch.resolvedTimestamp)
+                return false;
+
+            for (std::size_t k = 0; k < watch.signatures.size(); ++k) {
+                const auto& pattern = watch.signatures[k];
+                auto rva = watch.resolvedRvas[k];
+                watch.loadResults[k] = nullptr;
+                if (rva == Memory::ScanCacheNotFound || pattern.length >= sizeOfImage || rva >= sizeOfImage - pattern.length)
+                    continue;
+
+                Platform::RegionInfo info;
+                auto address = base + rva;
+                if (Platform::QueryRegion(address, info) && info.readable && address + pattern.length <= info.end && Memory::PatternMatches(address, pattern))
+                    watch.loadResults[k] = address;
+            }
+
+            // All or nothing, so a patch is never half applied
+            for (const auto& patch : watch.patches) {
+                if (!watch.loadResults[patch.signature])
+                    return false;
+            }
+            for (const auto& patch : watch.patches) {
+                if (!WriteUnstarted(watch.loadResults[patch.signature], patch.bytes.data(), patch.bytes.size()))
+                    return false;
+            }
+            return true;
+        }
+
+        static VOID CALLBACK Notification(ULONG reason, const NotificationData* data, PVOID context)
+        {
+            auto watcher = static_cast<Watcher*>(context);
+            auto module = (HMODULE)data->DllBase;
+            bool wake = false;
+            for (auto& watch : watcher->watches) {
+                if (!NameMatches(watch.name, data->BaseDllName))
+                    continue;
+
+                if (reason == ReasonUnloaded) {
+                    HMODULE expected = module;
+                    watch.loaded.compare_exchange_strong(expected, nullptr, std::memory_order_relaxed);
+                }
+                else if (reason == ReasonLoaded) {
+                    watch.patchedAtLoad = PatchAtLoad(watch, (std::uint8_t*)data->DllBase, data->SizeOfImage);
+                    watch.loaded.store(module, std::memory_order_relaxed);
+                    watch.loads.fetch_add(1, std::memory_order_release);
+                    wake = true;
+                }
+            }
+            if (wake)
+                SetEvent(watcher->wakeEvent);
+        }
+
+        // Scans, patches what the notification didn't and runs the callback, once per load
+        void Handle(Watch& watch, bool initial)
+        {
+            auto loads = watch.loads.load(std::memory_order_acquire);
+            if (!initial && loads == watch.handledLoads)
+                return;
+
+            // Hold a reference while scanning. If it's been unloaded since, there's nothing to do.
+            HMODULE module = nullptr;
+            if (!GetModuleHandleExW(0, watch.name.c_str(), &module))
+                return;
+
+            // Read again now it can't be unloaded and reloaded, the load notification has run for this load unless it was
+            // already loaded before the watcher started
+            loads = watch.loads.load(std::memory_order_acquire);
+            bool notified = loads != 0 && watch.loaded.load(std::memory_order_relaxed) == module;
+            if (watch.handled == module && watch.handledLoads == loads) {
+                FreeLibrary(module);
+                return;
+            }
+            watch.handled = module;
+            watch.handledLoads = loads;
+
+            std::vector<std::uint8_t*> results;
+            Patched patched = Patched::No;
+            if (notified && watch.patchedAtLoad) {
+                results = watch.loadResults;
+                patched = Patched::AtLoad;
+            }
+            else {
+                results = Memory::PatternScanBatchCached(module, watch.signatures, watch.cacheFile);
+
+                auto base = reinterpret_cast<std::uint8_t*>(module);
+                std::vector<std::uint32_t> rvas;
+                for (auto result : results)
+                    rvas.push_back(result ? (std::uint32_t)(result - base) : Memory::ScanCacheNotFound);
+                Resolve(watch, Memory::ModuleTimestamp(module), rvas);
+
+                Memory::PatchTransaction transaction;
+                bool found = !watch.patches.empty();
+                for (const auto& patch : watch.patches) {
+                    found &= results[patch.signature] != nullptr;
+                    if (results[patch.signature])
+                        transaction.PatchBytes(results[patch.signature], patch.bytes.data(), patch.bytes.size(), "Module patch");
+                }
+                if (found && transaction.Commit())
+                    patched = Patched::AfterLoad;
+            }
+
+            if (watch.callback)
+                watch.callback(module, results, patched);
+            FreeLibrary(module);
+        }
+
+        void Worker()
+        {
+            // Anything loaded before the watcher started never gets a notification
+            for (auto& watch : watches)
+                Handle(watch, true);
+
+            while (WaitForSingleObject(wakeEvent, INFINITE) == WAIT_OBJECT_0) {
+                for (auto& watch : watches)
+                    Handle(watch, false);
+            }
+        }
+
+        // A deque, so watches never move
+        std::deque<Watch> watches;
+        bool started = false;
+        HANDLE wakeEvent = nullptr;
+        PVOID cookie = nullptr;
+    };
+}
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <algorithm>
+#include <cstddef>
+
+// Frame pacer for the frame limiter.
+// Each frame gets a deadline one interval after the previous one. The wait sleeps until a margin before the deadline and
+// spins the rest of the way, since sleeps can wake late but spinning can't. The margin follows how late sleeps have been
+// waking recently (a decaying maximum), so it stays small with a high resolution timer and grows when the OS is coarse.
+// A frame that's already late resets the schedule instead of letting the next frames run early to catch up.
+// Takes the clock as a template parameter, so the same code runs against a simulated clock (see tools/pacersim.cpp).
+// The clock needs:
+//   double Now()              Current time in milliseconds
+//   void Sleep(double ms)     Sleeps for about ms, may wake late
+//   void Spin()               One iteration of a busy wait
+
+namespace Pacing
+{
+    struct Settings
+    {
+        double targetFrameMs = 1000.0 / 116.0;
+        double minSpinMs = 0.2;         // Always spin at least this long
+        double maxSpinMs = 4.0;         // Never spin longer than this, however late sleeps wake
+        double overshootDecay = 0.995;  // Per sleep, how fast a late wake is forgotten
+    };
+
+    template<typename Clock>
+    class Pacer
+    {
+    public:
+        Pacer(Clock& clock, const Settings& settings) : clock(clock), settings(settings), spinMs(settings.minSpinMs) {}
+
+        // Returns once the next frame is due, with how long it waited in milliseconds
+        double Wait()
+        {
+            double now = clock.Now();
+            double start = now;
+            if (!scheduled) {
+                deadline = now;
+                scheduled = true;
+                return 0.0;
+            }
+
+            deadline += settings.targetFrameMs;
+            if (now >= deadline) {
+                deadline = now;
+                ++lateFrames;
+                return 0.0;
+            }
+
+            while (deadline - now > spinMs) {
+                double requested = deadline - now - spinMs;
+                clock.Sleep(requested);
+                double woke = clock.Now();
+
+                double overshoot = std::max(woke - now - requested, 0.0);
+                worstOvershoot = std::max(overshoot, worstOvershoot * settings.overshootDecay);
+                spinMs = std::clamp(worstOvershoot * 1.25, settings.minSpinMs, settings.maxSpinMs);
+                now = woke;
+            }
+
+            double spinStart = now;
+            while (now < deadline) {
+                clock.Spin();
+                now = clock.Now();
+            }
+            spinTotalMs += now - spinStart;
+            return now - start;
+        }
+
+        // Starts a new schedule, eg. after a pause or a change of target
+        void Reset(const Settings& newSettings)
+        {
+            settings = newSettings;
+            scheduled = false;
+        }
+
+        double SpinMarginMs() const { return spinMs; }
+        double SpinTotalMs() const { return spinTotalMs; }
+        std::size_t LateFrames() const { return lateFrames; }
+
+    private:
+        Clock& clock;
+        Settings settings;
+        bool scheduled = false;
+        double deadline = 0.0;
+        double spinMs;
+        double worstOvershoot = 0.0;
+        double spinTotalMs = 0.0;
+        std::size_t lateFrames = 0;
+    };
+}
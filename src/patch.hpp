@@ -0,0 +1,280 @@
+#pragma once
+
+#include "helper.hpp"
+#include "timeline.hpp"
+
+#include <tlhelp32.h>
+#include <safetyhook.hpp>
+
+#include <string>
+#include <vector>
+
+namespace Memory
+{
+    // Suspends every other thread in the process for as long as it's alive.
+    // Nothing may allocate while threads are frozen (a frozen thread could hold the heap lock), so the thread list is
+    // gathered up front. Freeze() fails if a thread is stopped inside one of the given ranges, since it could be in the
+    // middle of an instruction that's about to change, and the caller should retry.
+    class ThreadFreeze
+    {
+    public:
+        struct Range
+        {
+            std::uint8_t* begin;
+            std::uint8_t* end;
+        };
+
+        ThreadFreeze()
+        {
+            HANDLE snapshot = CreateToolhelp32Snapshot(TH32CS_SNAPTHREAD, 0);
+            if (snapshot == INVALID_HANDLE_VALUE)
+                return;
+
+            THREADENTRY32 entry{ sizeof(entry) };
+            for (BOOL more = Thread32First(snapshot, &entry); more; more = Thread32Next(snapshot, &entry)) {
+                if (entry.th32OwnerProcessID != GetCurrentProcessId() || entry.th32ThreadID == GetCurrentThreadId())
+                    continue;
+                if (HANDLE thread = OpenThread(THREAD_SUSPEND_RESUME | THREAD_GET_CONTEXT, FALSE, entry.th32ThreadID))
+                    threads.push_back(thread);
+            }
+            CloseHandle(snapshot);
+            suspended.reserve(threads.size());
+        }
+
+        ~ThreadFreeze()
+        {
+            Thaw();
+            for (auto thread : threads)
+                CloseHandle(thread);
+        }
+
+        ThreadFreeze(const ThreadFreeze&) = delete;
+        ThreadFreeze& operator=(const ThreadFreeze&) = delete;
+
+        bool Freeze(const std::vector<Range>& ranges)
+        {
+            for (auto thread : threads) {
+                if (SuspendThread(thread) == (DWORD)-1)
+                    continue;
+                suspended.push_back(thread);
+
+                // GetThreadContext waits for the suspension to actually happen
+                CONTEXT context{};
+                context.ContextFlags = CONTEXT_CONTROL;
+                if (!GetThreadContext(thread, &context))
+                    continue;
+
+                auto ip = reinterpret_cast<std::uint8_t*>(context.Rip);
+                for (const auto& range : ranges) {
+                    if (ip >= range.begin && ip < range.end) {
+                        Thaw();
+                        return false;
+                    }
+                }
+            }
+            return true;
+        }
+
+        void Thaw()
+        {
+            for (auto thread : suspended)
+                ResumeThread(thread);
+            suspended.clear();
+        }
+
+    private:
+        std::vector<HANDLE> threads;
+        std::vector<HANDLE> suspended;
+    };
+
+    // Collects byte patches and mid hooks, then applies them all at once.
+    // Byte patches are written in a single window with every other thread frozen, with one protection change per run
+    // of pages that share a protection instead of two per patch. Mid hooks are created afterwards, so any patched bytes
+    // they relocate are already in place, and safetyhook handles running threads itself. If anything fails, everything
+    // already applied is undone and Commit() returns false.
+    class PatchTransaction
+    {
+    public:
+        void PatchBytes(std::uint8_t* address, const void* bytes, std::size_t size, const char* name)
+        {
+            std::scoped_lock lock(mutex);
+            auto data = static_cast<const std::uint8_t*>(bytes);
+            patches.push_back({ address, std::vector<std::uint8_t>(data, data + size), {}, name });
+        }
+
+        template<typename T>
+        void Write(std::uint8_t* address, T value, const char* name)
+        {
+            PatchBytes(address, &value, sizeof(T), name);
+        }
+
+        void MidHook(SafetyHookMid& hook, std::uint8_t* target, safetyhook::MidHookFn destination, const char* name)
+        {
+            std::scoped_lock lock(mutex);
+            hooks.push_back({ &hook, target, destination, name });
+        }
+
+        std::size_t PatchCount() const { return patches.size(); }
+        std::size_t HookCount() const { return hooks.size(); }
+        const std::string& LastError() const { return error; }
+
+        bool Commit()
+        {
+            std::scoped_lock lock(mutex, PatchMutex);
+
+            // Save original bytes first, so there's nothing left to allocate once threads are frozen
+            for (auto& patch : patches) {
+                Platform::RegionInfo region;
+                if (!Platform::QueryRegion(patch.address, region) || !region.readable || region.end < patch.address + patch.bytes.size()) {
+                    error = std::string(patch.name) + ": Address isn't mapped";
+                    return false;
+                }
+                patch.original.assign(patch.address, patch.address + patch.bytes.size());
+            }
+
+            {
+                Timeline::Span span("Patch", "Byte patches");
+                if (!WritePatches(false))
+                    return false;
+            }
+
+            for (std::size_t i = 0; i < hooks.size(); ++i) {
+                auto& hook = hooks[i];
+                Timeline::Span span("Hook", hook.name);
+                auto result = safetyhook::MidHook::create(hook.target, hook.destination);
+                if (!result) {
+                    error = std::string(hook.name) + ": Failed to create hook";
+                    for (std::size_t j = i; j-- > 0;)
+                        hooks[j].hook->reset();
+                    WritePatches(true);
+                    return false;
+                }
+                *hook.hook = std::move(*result);
+            }
+
+            return true;
+        }
+
+    private:
+        struct BytePatch
+        {
+            std::uint8_t* address;
+            std::vector<std::uint8_t> bytes;
+            std::vector<std::uint8_t> original;
+            const char* name;
+        };
+
+        struct HookPatch
+        {
+            SafetyHookMid* hook;
+            std::uint8_t* target;
+            safetyhook::MidHookFn destination;
+            const char* name;
+        };
+
+        struct ProtectRun
+        {
+            std::uint8_t* begin;
+            std::size_t size;
+            DWORD protect;
+        };
+
+        // Page-aligned runs covering every patch, split wherever the existing protection changes
+        std::vector<ProtectRun> ProtectRuns()
+        {
+            SYSTEM_INFO info;
+            GetSystemInfo(&info);
+            auto pageSize = (std::uintptr_t)info.dwPageSize;
+
+            std::vector<ThreadFreeze::Range> pages;
+            for (const auto& patch : patches) {
+                auto begin = (std::uintptr_t)patch.address & ~(pageSize - 1);
+                auto end = ((std::uintptr_t)patch.address + patch.bytes.size() + pageSize - 1) & ~(pageSize - 1);
+                pages.push_back({ (std::uint8_t*)begin, (std::uint8_t*)end });
+            }
+            std::sort(pages.begin(), pages.end(), [](const auto& a, const auto& b) { return a.begin < b.begin; });
+
+            std::vector<ThreadFreeze::Range> merged;
+            for (const auto& range : pages) {
+                if (!merged.empty() && range.begin <= merged.back().end)
+                    merged.back().end = std::max(merged.back().end, range.end);
+                else
+                    merged.push_back(range);
+            }
+
+            std::vector<ProtectRun> runs;
+            for (const auto& range : merged) {
+                for (auto address = range.begin; address < range.end;) {
+                    MEMORY_BASIC_INFORMATION region;
+                    if (VirtualQuery(address, &region, sizeof(region)) != sizeof(region))
+                        break;
+                    auto end = std::min(range.end, (std::uint8_t*)region.BaseAddress + region.RegionSize);
+                    runs.push_back({ address, (std::size_t)(end - address), region.Protect });
+                    address = end;
+                }
+            }
+            return runs;
+        }
+
+        bool WritePatches(bool restoreOriginal)
+        {
+            if (patches.empty())
+                return true;
+
+            auto runs = ProtectRuns();
+            std::vector<ThreadFreeze::Range> ranges;
+            for (const auto& patch : patches)
+                ranges.push_back({ patch.address, patch.address + patch.bytes.size() });
+
+            // Only a literal is kept while threads are frozen, the error string is built once they're running again
+            const char* failure = nullptr;
+            {
+                ThreadFreeze freeze;
+                bool frozen = false;
+                for (int attempt = 0; attempt < 100 && !frozen; ++attempt) {
+                    frozen = freeze.Freeze(ranges);
+                    if (!frozen)
+                        Sleep(1);
+                }
+                if (!frozen) {
+                    failure = "A thread kept running inside the patched code";
+                }
+                else {
+                    std::size_t unprotected = 0;
+                    for (; unprotected < runs.size(); ++unprotected) {
+                        DWORD oldProtect;
+                        if (!VirtualProtect(runs[unprotected].begin, runs[unprotected].size, PAGE_EXECUTE_READWRITE, &oldProtect))
+                            break;
+                    }
+
+                    if (unprotected == runs.size()) {
+                        for (const auto& patch : patches) {
+                            const auto& bytes = restoreOriginal ? patch.original : patch.bytes;
+                            std::memcpy(patch.address, bytes.data(), bytes.size());
+                        }
+                    }
+                    else {
+                        failure = "Failed to change memory protection";
+                    }
+
+                    for (std::size_t i = 0; i < unprotected; ++i) {
+                        DWORD oldProtect;
+                        VirtualProtect(runs[i].begin, runs[i].size, runs[i].protect, &oldProtect);
+                        FlushInstructionCache(GetCurrentProcess(), runs[i].begin, runs[i].size);
+                    }
+                }
+            }
+
+            if (failure) {
+                error = failure;
+                return false;
+            }
+            return true;
+        }
+
+        std::mutex mutex;
+        std::vector<BytePatch> patches;
+        std::vector<HookPatch> hooks;
+        std::string error;
+    };
+}
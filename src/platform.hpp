@@ -0,0 +1,159 @@
+#pragma once
+
+// Small platform shim for the scanning code in scanner.hpp, so it can also be built outside of the game (see tools/).
+// On Windows this is just windows.h, elsewhere it provides the few PE definitions and CPU/memory queries the scanner needs.
+
+#include <cstdint>
+#include <cstddef>
+
+#ifdef _WIN32
+
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#include <intrin.h>
+#include <immintrin.h>
+
+// MSVC allows AVX2 intrinsics in any function
+#define SCANNER_TARGET_AVX2
+
+#else
+
+#include <cpuid.h>
+#include <immintrin.h>
+
+#define SCANNER_TARGET_AVX2 __attribute__((target("avx2")))
+
+typedef std::uint8_t BYTE;
+typedef std::uint16_t WORD;
+typedef std::uint32_t DWORD;
+typedef std::int32_t LONG;
+typedef std::uint64_t ULONGLONG;
+
+#define IMAGE_SCN_CNT_CODE 0x00000020
+#define IMAGE_SCN_MEM_EXECUTE 0x20000000
+#define IMAGE_SCN_MEM_READ 0x40000000
+#define IMAGE_NUMBEROF_DIRECTORY_ENTRIES 16
+#define IMAGE_DIRECTORY_ENTRY_EXCEPTION 3
+
+typedef struct _IMAGE_DOS_HEADER {
+    WORD e_magic, e_cblp, e_cp, e_crlc, e_cparhdr, e_minalloc, e_maxalloc, e_ss, e_sp, e_csum, e_ip, e_cs, e_lfarlc, e_ovno;
+    WORD e_res[4];
+    WORD e_oemid, e_oeminfo;
+    WORD e_res2[10];
+    LONG e_lfanew;
+} IMAGE_DOS_HEADER, *PIMAGE_DOS_HEADER;
+
+typedef struct _IMAGE_FILE_HEADER {
+    WORD Machine;
+    WORD NumberOfSections;
+    DWORD TimeDateStamp;
+    DWORD PointerToSymbolTable;
+    DWORD NumberOfSymbols;
+    WORD SizeOfOptionalHeader;
+    WORD Characteristics;
+} IMAGE_FILE_HEADER;
+
+typedef struct _IMAGE_DATA_DIRECTORY {
+    DWORD VirtualAddress;
+    DWORD Size;
+} IMAGE_DATA_DIRECTORY;
+
+typedef struct _IMAGE_OPTIONAL_HEADER64 {
+    WORD Magic;
+    BYTE MajorLinkerVersion, MinorLinkerVersion;
+    DWORD SizeOfCode, SizeOfInitializedData, SizeOfUninitializedData, AddressOfEntryPoint, BaseOfCode;
+    ULONGLONG ImageBase;
+    DWORD SectionAlignment, FileAlignment;
+    WORD MajorOperatingSystemVersion, MinorOperatingSystemVersion, MajorImageVersion, MinorImageVersion, MajorSubsystemVersion, MinorSubsystemVersion;
+    DWORD Win32VersionValue, SizeOfImage, SizeOfHeaders, CheckSum;
+    WORD Subsystem, DllCharacteristics;
+    ULONGLONG SizeOfStackReserve, SizeOfStackCommit, SizeOfHeapReserve, SizeOfHeapCommit;
+    DWORD LoaderFlags, NumberOfRvaAndSizes;
+    IMAGE_DATA_DIRECTORY DataDirectory[IMAGE_NUMBEROF_DIRECTORY_ENTRIES];
+} IMAGE_OPTIONAL_HEADER64;
+
+typedef struct _IMAGE_NT_HEADERS64 {
+    DWORD Signature;
+    IMAGE_FILE_HEADER FileHeader;
+    IMAGE_OPTIONAL_HEADER64 OptionalHeader;
+} IMAGE_NT_HEADERS, *PIMAGE_NT_HEADERS;
+
+typedef struct _IMAGE_SECTION_HEADER {
+    BYTE Name[8];
+    union {
+        DWORD PhysicalAddress;
+        DWORD VirtualSize;
+    } Misc;
+    DWORD VirtualAddress, SizeOfRawData, PointerToRawData, PointerToRelocations, PointerToLinenumbers;
+    WORD NumberOfRelocations, NumberOfLinenumbers;
+    DWORD Characteristics;
+} IMAGE_SECTION_HEADER, *PIMAGE_SECTION_HEADER;
+
+typedef struct _IMAGE_RUNTIME_FUNCTION_ENTRY {
+    DWORD BeginAddress;
+    DWORD EndAddress;
+    DWORD UnwindData;
+} IMAGE_RUNTIME_FUNCTION_ENTRY;
+
+#define IMAGE_FIRST_SECTION(ntHeaders) ((PIMAGE_SECTION_HEADER)((std::uint8_t*)&(ntHeaders)->OptionalHeader + (ntHeaders)->FileHeader.SizeOfOptionalHeader))
+
+#endif
+
+namespace Platform
+{
+    void CpuId(int cpuInfo[4], int leaf, int subleaf)
+    {
+#ifdef _WIN32
+        __cpuidex(cpuInfo, leaf, subleaf);
+#else
+        unsigned int a, b, c, d;
+        __cpuid_count(leaf, subleaf, a, b, c, d);
+        cpuInfo[0] = (int)a;
+        cpuInfo[1] = (int)b;
+        cpuInfo[2] = (int)c;
+        cpuInfo[3] = (int)d;
+#endif
+    }
+
+    std::uint64_t XGetBV(unsigned int index)
+    {
+#ifdef _WIN32
+        return _xgetbv(index);
+#else
+        std::uint32_t eax, edx;
+        __asm__ volatile("xgetbv" : "=a"(eax), "=d"(edx) : "c"(index));
+        return ((std::uint64_t)edx << 32) | eax;
+#endif
+    }
+
+    struct RegionInfo
+    {
+        const std::uint8_t* end;    // First byte past the region containing the queried address
+        bool readable;
+    };
+
+    // Queries the memory region containing address. Returns false if the query failed.
+    bool QueryRegion(const void* address, RegionInfo& region)
+    {
+#ifdef _WIN32
+        MEMORY_BASIC_INFORMATION info;
+        if (VirtualQuery(address, &info, sizeof(info)) != sizeof(info))
+            return false;
+
+        region.end = reinterpret_cast<const std::uint8_t*>(info.BaseAddress) + info.RegionSize;
+        region.readable = info.State == MEM_COMMIT && info.Protect != 0 && !(info.Protect & (PAGE_NOACCESS | PAGE_GUARD));
+        return true;
+#else
+        // Offline images are mapped in full by the caller
+        (void)address;
+        region.end = reinterpret_cast<const std::uint8_t*>(UINTPTR_MAX);
+        region.readable = true;
+        return true;
+#endif
+    }
+}
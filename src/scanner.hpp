@@ -0,0 +1,677 @@
+#pragma once
+
+// Signature scanning and PE parsing. Only depends on platform.hpp and the standard library so it can be used offline too.
+
+#include "platform.hpp"
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <bit>
+#include <climits>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <span>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace Memory
+{
+    // Rough frequency rank of each byte value in x64 code (higher = more common).
+    // Only used to pick which signature byte to search for first, so it doesn't need to be exact.
+    constexpr std::array<std::uint8_t, 256> ByteFrequency = [] {
+        std::array<std::uint8_t, 256> freq{};
+        for (auto& f : freq)
+            f = 1;
+
+        constexpr std::uint8_t common[] = {
+            0x00, 0xFF, 0x48, 0x8B, 0xCC, 0x89, 0x0F, 0x4C, 0x8D, 0x24, 0xE8, 0x44, 0x85, 0x83, 0x01, 0x49,
+            0xC0, 0x41, 0x74, 0x75, 0x90, 0x33, 0xC3, 0x08, 0x10, 0x20, 0x40, 0x28, 0x30, 0x38, 0x18, 0x04,
+            0x02, 0x03, 0x45, 0x84, 0xC7, 0x5C, 0x4D, 0x80, 0xE9, 0xEB, 0x8A, 0xF3, 0x0D, 0x05, 0x15, 0x3B
+        };
+        std::uint8_t rank = 255;
+        for (auto b : common)
+            freq[b] = rank--;
+        return freq;
+    }();
+
+    // Signature compiled at build time from a string like "48 8B ?? 28". "?" and "??" are wildcards.
+    // Malformed signatures fail to compile.
+    struct Signature
+    {
+        static constexpr std::size_t MaxLength = 64;
+
+        std::array<std::uint8_t, MaxLength> bytes{};    // Pattern bytes, wildcards stored as 0
+        std::array<std::uint8_t, MaxLength> mask{};     // 0xFF = must match, 0x00 = wildcard
+        std::size_t length = 0;
+        std::size_t anchor = 0;                         // Rarest non-wildcard byte, searched for first
+        std::size_t guard = 0;                          // Second rarest non-wildcard byte, used to filter candidates
+        bool wildcardOnly = true;
+
+        // Checked at compile time in constant expressions (eg. the signature table). Patterns from the ini are parsed at
+        // runtime, where a bad one throws the message as a const char*.
+        constexpr Signature(const char* pattern)
+        {
+            auto hexValue = [](char c) {
+                if (c >= '0' && c <= '9') return c - '0';
+                if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+                if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+                return -1;
+            };
+
+            for (auto current = pattern; *current;) {
+                if (*current == ' ') {
+                    ++current;
+                    continue;
+                }
+                if (length == MaxLength)
+                    throw "Signature: pattern is longer than Signature::MaxLength bytes.";
+
+                if (*current == '?') {
+                    ++current;
+                    if (*current == '?')
+                        ++current;
+                }
+                else {
+                    int high = hexValue(*current++);
+                    if (high < 0)
+                        throw "Signature: invalid hex digit.";
+                    int low = hexValue(*current);
+                    if (low >= 0)
+                        ++current;
+
+                    bytes[length] = static_cast<std::uint8_t>(low >= 0 ? high * 16 + low : high);
+                    mask[length] = 0xFF;
+                }
+
+                if (*current && *current != ' ')
+                    throw "Signature: bytes must be separated by spaces.";
+                ++length;
+            }
+
+            if (length == 0)
+                throw "Signature: pattern is empty.";
+
+            // Pick the two least common fixed bytes so the vector compare throws away as many offsets as possible
+            int anchorFreq = INT_MAX;
+            int guardFreq = INT_MAX;
+            for (std::size_t i = 0; i < length; ++i) {
+                if (!mask[i])
+                    continue;
+
+                int freq = ByteFrequency[bytes[i]];
+                if (freq < anchorFreq) {
+                    guard = anchor;
+                    guardFreq = anchorFreq;
+                    anchor = i;
+                    anchorFreq = freq;
+                }
+                else if (freq < guardFreq) {
+                    guard = i;
+                    guardFreq = freq;
+                }
+                wildcardOnly = false;
+            }
+
+            // Only one fixed byte, so the guard is just the anchor again
+            if (guardFreq == INT_MAX)
+                guard = anchor;
+        }
+    };
+
+    inline bool PatternMatches(const std::uint8_t* data, const Signature& pattern)
+    {
+        const auto* bytes = pattern.bytes.data();
+        const auto* mask = pattern.mask.data();
+        for (std::size_t j = 0; j < pattern.length; ++j) {
+            if ((data[j] & mask[j]) != bytes[j])
+                return false;
+        }
+        return true;
+    }
+
+    enum class ScanEngine { Scalar, SSE2, AVX2 };
+
+    ScanEngine DetectScanEngine()
+    {
+        int cpuInfo[4] = {};
+        Platform::CpuId(cpuInfo, 0, 0);
+        if (cpuInfo[0] >= 7) {
+            // AVX2 needs both the CPU flag and the OS saving YMM state
+            Platform::CpuId(cpuInfo, 1, 0);
+            bool osxsave = (cpuInfo[2] & (1 << 27)) != 0;
+            bool avx = (cpuInfo[2] & (1 << 28)) != 0;
+            Platform::CpuId(cpuInfo, 7, 0);
+            bool avx2 = (cpuInfo[1] & (1 << 5)) != 0;
+            if (osxsave && avx && avx2 && (Platform::XGetBV(0) & 0x6) == 0x6)
+                return ScanEngine::AVX2;
+        }
+        // SSE2 is baseline on x64
+        return ScanEngine::SSE2;
+    }
+
+    // Engine used by FindPattern/FindPatterns. Can be lowered to compare engines when benchmarking.
+    ScanEngine CurrentScanEngine = DetectScanEngine();
+
+    // Candidate offsets are [0, count), every candidate has the whole pattern in bounds.
+    const std::uint8_t* FindPatternScalar(const std::uint8_t* data, std::size_t begin, std::size_t count, const Signature& pattern)
+    {
+        const std::uint8_t anchorByte = pattern.bytes[pattern.anchor];
+        for (auto i = begin; i < count; ++i) {
+            if (data[i + pattern.anchor] == anchorByte && PatternMatches(data + i, pattern))
+                return data + i;
+        }
+        return nullptr;
+    }
+
+    const std::uint8_t* FindPatternSSE2(const std::uint8_t* data, std::size_t count, const Signature& pattern)
+    {
+        const __m128i anchorByte = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.anchor]));
+        const __m128i guardByte = _mm_set1_epi8(static_cast<char>(pattern.bytes[pattern.guard]));
+
+        std::size_t i = 0;
+        for (; i + 16 <= count; i += 16) {
+            __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.anchor));
+            __m128i g = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + i + pattern.guard));
+            unsigned int hits = _mm_movemask_epi8(_mm_and_si128(_mm_cmpeq_epi8(a, anchorByte), _mm_cmpeq_epi8(g, guardByte)));
+            while (hits) {
+                auto bit = std::countr_zero(hits);
+                if (PatternMatches(data + i + bit, pattern))
+                    return data + i + bit;
+                hits &= hits - 1;
+            }
+        }
+        return FindPatternScalar(data, i, count, pattern);
+    }
+
+    SCANNER_TARGET_AVX2 const std::uint8_t* FindPatternAVX2(const std::uint8_t* data, std::size_t count, const Signature& pattern)
+    {
+        const __m256i anchorByte = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.anchor]));
+        const __m256i guardByte = _mm256_set1_epi8(static_cast<char>(pattern.bytes[pattern.guard]));
+
+        std::size_t i = 0;
+        for (; i + 32 <= count; i += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.anchor));
+            __m256i g = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + i + pattern.guard));
+            unsigned int hits = static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_and_si256(_mm256_cmpeq_epi8(a, anchorByte), _mm256_cmpeq_epi8(g, guardByte))));
+            while (hits) {
+                auto bit = std::countr_zero(hits);
+                if (PatternMatches(data + i + bit, pattern))
+                    return data + i + bit;
+                hits &= hits - 1;
+            }
+        }
+        _mm256_zeroupper();
+        return FindPatternScalar(data, i, count, pattern);
+    }
+
+    // Returns the first offset in data[0, size) where the pattern matches.
+    // The last possible offset (size - pattern length) is deliberately excluded to match the original scanner.
+    const std::uint8_t* FindPattern(const std::uint8_t* data, std::size_t size, const Signature& pattern)
+    {
+        auto s = pattern.length;
+        if (s == 0 || size <= s)
+            return nullptr;
+
+        auto count = size - s;
+        if (pattern.wildcardOnly)
+            return data;
+
+        switch (CurrentScanEngine) {
+        case ScanEngine::AVX2:
+            return FindPatternAVX2(data, count, pattern);
+        case ScanEngine::SSE2:
+            return FindPatternSSE2(data, count, pattern);
+        default:
+            return FindPatternScalar(data, 0, count, pattern);
+        }
+    }
+
+    // Batch scanning finds the first match of every signature in a single pass over the image.
+    // Each signature gets a fingerprint of two adjacent fixed bytes and one of 8 bucket bits. A nibble shuffle lookup
+    // flags every offset that could start any fingerprint, so the pass costs the same however many signatures there are.
+    struct BatchEntry
+    {
+        const Signature* pattern;
+        std::size_t count;          // Candidate offsets are [0, count)
+        std::size_t offset;         // Offset of the fingerprint within the pattern
+        std::uint8_t first;
+        std::uint8_t second;
+        bool twoBytes;
+        std::size_t index;
+    };
+
+    struct BatchScan
+    {
+        std::vector<BatchEntry> entries;
+        std::vector<std::size_t> buckets[8];
+        std::uint8_t firstTable[256] = {};
+        std::uint8_t secondTable[256] = {};
+        alignas(16) std::uint8_t firstLo[16] = {};
+        alignas(16) std::uint8_t firstHi[16] = {};
+        alignas(16) std::uint8_t secondLo[16] = {};
+        alignas(16) std::uint8_t secondHi[16] = {};
+    };
+
+    BatchEntry MakeBatchEntry(const Signature& pattern, std::size_t count, std::size_t index)
+    {
+        BatchEntry entry{ &pattern, count, pattern.anchor, pattern.bytes[pattern.anchor], 0, false, index };
+
+        // Prefer the rarest pair of adjacent fixed bytes
+        int bestFreq = INT_MAX;
+        for (std::size_t i = 0; i + 1 < pattern.length; ++i) {
+            if (!pattern.mask[i] || !pattern.mask[i + 1])
+                continue;
+
+            int freq = ByteFrequency[pattern.bytes[i]] + ByteFrequency[pattern.bytes[i + 1]];
+            if (freq < bestFreq) {
+                bestFreq = freq;
+                entry.offset = i;
+                entry.first = pattern.bytes[i];
+                entry.second = pattern.bytes[i + 1];
+                entry.twoBytes = true;
+            }
+        }
+        return entry;
+    }
+
+    // Returns false once every signature has been found
+    inline bool CheckBatchCandidates(const std::uint8_t* data, std::size_t pos, std::uint8_t bucketBits, BatchScan& batch, std::vector<const std::uint8_t*>& results, std::size_t& remaining)
+    {
+        while (bucketBits) {
+            auto bucket = std::countr_zero(bucketBits);
+            bucketBits &= bucketBits - 1;
+
+            for (auto k : batch.buckets[bucket]) {
+                const auto& entry = batch.entries[k];
+                if (results[entry.index] || data[pos] != entry.first || pos < entry.offset)
+                    continue;
+                if (entry.twoBytes && data[pos + 1] != entry.second)
+                    continue;
+
+                auto i = pos - entry.offset;
+                if (i < entry.count && PatternMatches(data + i, *entry.pattern)) {
+                    results[entry.index] = data + i;
+                    if (--remaining == 0)
+                        return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void FindPatternsScalar(const std::uint8_t* data, std::size_t begin, std::size_t end, BatchScan& batch, std::vector<const std::uint8_t*>& results, std::size_t& remaining)
+    {
+        for (auto pos = begin; pos < end; ++pos) {
+            std::uint8_t bits = batch.firstTable[data[pos]] & batch.secondTable[data[pos + 1]];
+            if (bits && !CheckBatchCandidates(data, pos, bits, batch, results, remaining))
+                return;
+        }
+    }
+
+    SCANNER_TARGET_AVX2 void FindPatternsAVX2(const std::uint8_t* data, std::size_t end, BatchScan& batch, std::vector<const std::uint8_t*>& results, std::size_t& remaining)
+    {
+        const __m256i nibbleMask = _mm256_set1_epi8(0x0F);
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i firstLo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(batch.firstLo)));
+        const __m256i firstHi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(batch.firstHi)));
+        const __m256i secondLo = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(batch.secondLo)));
+        const __m256i secondHi = _mm256_broadcastsi128_si256(_mm_load_si128(reinterpret_cast<const __m128i*>(batch.secondHi)));
+        alignas(32) std::uint8_t bucketBits[32];
+
+        std::size_t pos = 0;
+        for (; pos + 32 <= end; pos += 32) {
+            __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos));
+            __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + pos + 1));
+
+            __m256i aBits = _mm256_and_si256(
+                _mm256_shuffle_epi8(firstLo, _mm256_and_si256(a, nibbleMask)),
+                _mm256_shuffle_epi8(firstHi, _mm256_and_si256(_mm256_srli_epi16(a, 4), nibbleMask)));
+            __m256i bBits = _mm256_and_si256(
+                _mm256_shuffle_epi8(secondLo, _mm256_and_si256(b, nibbleMask)),
+                _mm256_shuffle_epi8(secondHi, _mm256_and_si256(_mm256_srli_epi16(b, 4), nibbleMask)));
+            __m256i bits = _mm256_and_si256(aBits, bBits);
+
+            unsigned int hits = ~static_cast<unsigned int>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(bits, zero)));
+            if (!hits)
+                continue;
+
+            _mm256_store_si256(reinterpret_cast<__m256i*>(bucketBits), bits);
+            while (hits) {
+                auto bit = std::countr_zero(hits);
+                hits &= hits - 1;
+                if (!CheckBatchCandidates(data, pos + bit, bucketBits[bit], batch, results, remaining)) {
+                    _mm256_zeroupper();
+                    return;
+                }
+            }
+        }
+        _mm256_zeroupper();
+        FindPatternsScalar(data, pos, end, batch, results, remaining);
+    }
+
+    // Returns the first match of each pattern in data[0, size), same as calling FindPattern for each of them.
+    std::vector<const std::uint8_t*> FindPatterns(const std::uint8_t* data, std::size_t size, std::span<const Signature> patterns)
+    {
+        std::vector<const std::uint8_t*> results(patterns.size(), nullptr);
+        BatchScan batch;
+
+        for (std::size_t k = 0; k < patterns.size(); ++k) {
+            const auto& pattern = patterns[k];
+            auto s = pattern.length;
+            if (s == 0 || size <= s)
+                continue;
+            if (pattern.wildcardOnly) {
+                results[k] = data;
+                continue;
+            }
+
+            auto entry = MakeBatchEntry(pattern, size - s, k);
+            auto bucket = batch.entries.size() % 8;
+            auto bit = static_cast<std::uint8_t>(1 << bucket);
+
+            batch.firstTable[entry.first] |= bit;
+            batch.firstLo[entry.first & 0x0F] |= bit;
+            batch.firstHi[entry.first >> 4] |= bit;
+            if (entry.twoBytes) {
+                batch.secondTable[entry.second] |= bit;
+                batch.secondLo[entry.second & 0x0F] |= bit;
+                batch.secondHi[entry.second >> 4] |= bit;
+            }
+            else {
+                // Single fixed byte, any following byte is fine
+                for (auto& b : batch.secondTable) b |= bit;
+                for (auto& b : batch.secondLo) b |= bit;
+                for (auto& b : batch.secondHi) b |= bit;
+            }
+
+            batch.buckets[bucket].push_back(batch.entries.size());
+            batch.entries.push_back(entry);
+        }
+
+        auto remaining = batch.entries.size();
+        if (remaining == 0)
+            return results;
+
+        // Fingerprints are two bytes long, so the last byte can't start one
+        auto end = size - 1;
+        if (CurrentScanEngine == ScanEngine::AVX2)
+            FindPatternsAVX2(data, end, batch, results, remaining);
+        else
+            FindPatternsScalar(data, 0, end, batch, results, remaining);
+
+        return results;
+    }
+
+    enum class ScanScope { Code, Image };
+
+    struct ScanRegion
+    {
+        const std::uint8_t* data;
+        std::size_t size;
+    };
+
+    // Splits [start, start + size) into runs of committed, readable pages
+    void AddReadableRegions(const std::uint8_t* start, std::size_t size, std::vector<ScanRegion>& regions)
+    {
+        const std::uint8_t* end = start + size;
+        const std::uint8_t* current = start;
+
+        while (current < end) {
+            Platform::RegionInfo info;
+            if (!Platform::QueryRegion(current, info))
+                break;
+
+            auto regionEnd = std::min(end, info.end);
+            if (info.readable) {
+                // Merge with the previous run if it's contiguous
+                if (!regions.empty() && regions.back().data + regions.back().size == current)
+                    regions.back().size += regionEnd - current;
+                else
+                    regions.push_back({ current, static_cast<std::size_t>(regionEnd - current) });
+            }
+            current = regionEnd;
+        }
+    }
+
+    std::vector<ScanRegion> GetScanRegions(void* module, ScanScope scope)
+    {
+        auto base = reinterpret_cast<const std::uint8_t*>(module);
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+
+        std::vector<ScanRegion> regions;
+        if (scope == ScanScope::Image) {
+            AddReadableRegions(base, ntHeaders->OptionalHeader.SizeOfImage, regions);
+            return regions;
+        }
+
+        auto section = IMAGE_FIRST_SECTION(ntHeaders);
+        for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section) {
+            if (!(section->Characteristics & (IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_CNT_CODE)))
+                continue;
+
+            auto size = section->Misc.VirtualSize ? section->Misc.VirtualSize : section->SizeOfRawData;
+            AddReadableRegions(base + section->VirtualAddress, size, regions);
+        }
+        return regions;
+    }
+
+    // Scan regions are split into chunks that overlap by the longest pattern, and chunks are handed out to a small pool
+    // of worker threads. Each signature keeps the match from the lowest chunk, so results don't depend on thread timing.
+    constexpr std::size_t ScanChunkSize = 2 * 1024 * 1024;
+
+    std::vector<const std::uint8_t*> FindPatternsParallel(const std::vector<ScanRegion>& regions, std::span<const Signature> patterns)
+    {
+        std::size_t maxLength = 0;
+        for (const auto& pattern : patterns)
+            maxLength = std::max(maxLength, pattern.length);
+
+        std::vector<ScanRegion> chunks;
+        for (const auto& region : regions) {
+            for (std::size_t offset = 0; offset < region.size; offset += ScanChunkSize) {
+                auto size = std::min(ScanChunkSize + maxLength, region.size - offset);
+                chunks.push_back({ region.data + offset, size });
+            }
+        }
+
+        // Lowest chunk each signature has been found in so far
+        std::vector<std::atomic<std::size_t>> foundChunk(patterns.size());
+        for (auto& found : foundChunk)
+            found = SIZE_MAX;
+
+        std::vector<std::vector<const std::uint8_t*>> chunkResults(chunks.size());
+        std::atomic<std::size_t> nextChunk = 0;
+
+        auto worker = [&] {
+            std::vector<Signature> pending;
+            std::vector<std::size_t> pendingIndex;
+
+            for (std::size_t c = nextChunk++; c < chunks.size(); c = nextChunk++) {
+                // Skip signatures that an earlier chunk already found
+                pending.clear();
+                pendingIndex.clear();
+                for (std::size_t k = 0; k < patterns.size(); ++k) {
+                    if (foundChunk[k].load(std::memory_order_relaxed) > c) {
+                        pending.push_back(patterns[k]);
+                        pendingIndex.push_back(k);
+                    }
+                }
+                if (pending.empty())
+                    continue;
+
+                auto found = FindPatterns(chunks[c].data, chunks[c].size, pending);
+                auto& results = chunkResults[c];
+                results.assign(patterns.size(), nullptr);
+                for (std::size_t j = 0; j < pending.size(); ++j) {
+                    if (!found[j])
+                        continue;
+
+                    auto k = pendingIndex[j];
+                    results[k] = found[j];
+                    auto current = foundChunk[k].load(std::memory_order_relaxed);
+                    while (c < current && !foundChunk[k].compare_exchange_weak(current, c, std::memory_order_relaxed)) {}
+                }
+            }
+        };
+
+        auto threadCount = std::min<std::size_t>({ std::max(1u, std::thread::hardware_concurrency()), 16, chunks.size() });
+        std::vector<std::thread> threads;
+        for (std::size_t t = 1; t < threadCount; ++t)
+            threads.emplace_back(worker);
+        worker();
+        for (auto& thread : threads)
+            thread.join();
+
+        std::vector<const std::uint8_t*> results(patterns.size(), nullptr);
+        for (std::size_t k = 0; k < patterns.size(); ++k) {
+            auto c = foundChunk[k].load();
+            if (c != SIZE_MAX)
+                results[k] = chunkResults[c][k];
+        }
+        return results;
+    }
+
+    std::vector<std::uint8_t*> PatternScanBatch(void* module, std::span<const Signature> signatures, ScanScope scope = ScanScope::Code)
+    {
+        std::vector<std::uint8_t*> results;
+        results.reserve(signatures.size());
+        for (auto result : FindPatternsParallel(GetScanRegions(module, scope), signatures))
+            results.push_back(const_cast<std::uint8_t*>(result));
+        return results;
+    }
+
+    std::uint8_t* PatternScan(void* module, const Signature& signature, ScanScope scope = ScanScope::Code)
+    {
+        return PatternScanBatch(module, { &signature, 1 }, scope)[0];
+    }
+
+    std::uint8_t* MultiPatternScan(void* module, std::span<const Signature> signatures)
+    {
+        for (auto result : PatternScanBatch(module, signatures)) {
+            if (result) {
+                return result;
+            }
+        }
+        return nullptr;
+    }
+
+    std::uint32_t ModuleTimestamp(void* module)
+    {
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)((std::uint8_t*)module + dosHeader->e_lfanew);
+        return ntHeaders->FileHeader.TimeDateStamp;
+    }
+
+    // Scan cache. Stores the RVA each signature was found at (or that it wasn't found), keyed by the module timestamp.
+    // Cached hits are re-checked against the pattern before use, anything else falls back to a normal scan.
+    std::uint64_t SignatureHash(const Signature& signature, ScanScope scope)
+    {
+        // FNV-1a over the compiled bytes, so formatting differences in the source string don't matter
+        std::uint64_t hash = 0xCBF29CE484222325ull;
+        auto add = [&hash](std::uint8_t value) {
+            hash ^= value;
+            hash *= 0x100000001B3ull;
+        };
+        for (std::size_t i = 0; i < signature.length; ++i) {
+            add(signature.bytes[i]);
+            add(signature.mask[i]);
+        }
+        add(static_cast<std::uint8_t>(scope));
+        return hash;
+    }
+
+    // An RVA that's never in range. Misses aren't cached, since the code might be there next time (eg. patched by
+    // something else on this run), so they're always scanned for again.
+    constexpr std::uint32_t ScanCacheNotFound = 0xFFFFFFFF;
+
+    // Batches can be scanned in parallel against the same cache file, so it's only read and written under this lock
+    std::mutex ScanCacheMutex;
+
+    // Must hold ScanCacheMutex. Returns the timestamp of the module the file was written for, or 0 if there's no cache.
+    std::uint32_t ReadScanCache(const std::filesystem::path& cacheFile, std::unordered_map<std::uint64_t, std::uint32_t>& cache)
+    {
+        std::uint32_t cachedTimestamp = 0;
+        if (std::ifstream file(cacheFile); file && file >> std::hex >> cachedTimestamp) {
+            std::uint64_t hash;
+            std::uint32_t rva;
+            while (file >> hash >> rva) {
+                // Misses from older caches
+                if (rva != ScanCacheNotFound)
+                    cache.try_emplace(hash, rva);
+            }
+        }
+        return cachedTimestamp;
+    }
+
+    std::vector<std::uint8_t*> PatternScanBatchCached(void* module, std::span<const Signature> signatures, const std::filesystem::path& cacheFile, std::size_t* cacheHits = nullptr, ScanScope scope = ScanScope::Code)
+    {
+        auto base = reinterpret_cast<std::uint8_t*>(module);
+        auto dosHeader = (PIMAGE_DOS_HEADER)module;
+        auto ntHeaders = (PIMAGE_NT_HEADERS)(base + dosHeader->e_lfanew);
+        auto sizeOfImage = ntHeaders->OptionalHeader.SizeOfImage;
+        auto timestamp = ModuleTimestamp(module);
+
+        // Read cache, ignoring it entirely if it's from a different version of the module
+        std::unordered_map<std::uint64_t, std::uint32_t> cache;
+        {
+            std::scoped_lock lock(ScanCacheMutex);
+            if (ReadScanCache(cacheFile, cache) != timestamp)
+                cache.clear();
+        }
+
+        std::vector<std::uint8_t*> results(signatures.size(), nullptr);
+        std::vector<Signature> missing;
+        std::vector<std::size_t> missingIndex;
+        std::size_t hits = 0;
+
+        for (std::size_t k = 0; k < signatures.size(); ++k) {
+            auto entry = cache.find(SignatureHash(signatures[k], scope));
+            if (entry != cache.end()) {
+                // Make sure the bytes at the cached address still match
+                const auto& pattern = signatures[k];
+                auto rva = entry->second;
+                if (pattern.length < sizeOfImage && rva < sizeOfImage - pattern.length) {
+                    Platform::RegionInfo info;
+                    auto address = base + rva;
+                    if (Platform::QueryRegion(address, info) && info.readable && address + pattern.length <= info.end &&
+                        PatternMatches(address, pattern)) {
+                        results[k] = address;
+                        ++hits;
+                        continue;
+                    }
+                }
+            }
+            missing.push_back(signatures[k]);
+            missingIndex.push_back(k);
+        }
+
+        if (cacheHits)
+            *cacheHits = hits;
+        if (missing.empty())
+            return results;
+
+        auto scanned = PatternScanBatch(module, missing, scope);
+        std::unordered_map<std::uint64_t, std::uint32_t> updated;
+        for (std::size_t j = 0; j < missing.size(); ++j) {
+            results[missingIndex[j]] = scanned[j];
+            if (scanned[j])
+                updated[SignatureHash(missing[j], scope)] = static_cast<std::uint32_t>(scanned[j] - base);
+        }
+
+        // Write updated cache, on top of whatever other batches have written since it was read
+        std::scoped_lock lock(ScanCacheMutex);
+        cache.clear();
+        if (ReadScanCache(cacheFile, cache) == timestamp)
+            updated.merge(cache);
+        if (std::ofstream file(cacheFile, std::ios::trunc); file) {
+            file << std::hex << timestamp << "\n";
+            for (const auto& [hash, rva] : updated)
+                file << hash << " " << rva << "\n";
+        }
+
+        return results;
+    }
+}
@@ -0,0 +1,69 @@
+#pragma once
+
+// Every signature the fix scans for. Shared with the offline tools so signatures can be checked without running the game.
+// Each fix has one or more variants, one per game version whose code differs. All variants are scanned for in the same
+// pass and the first one in table order that matches is used. Supporting a new game update means adding a variant here.
+
+#include "scanner.hpp"
+
+#include <string_view>
+
+enum class Sig : std::size_t {
+    SkipIntroVideo,
+    ConsoleCVarRestrictions,
+    BindCVarRestrictions,
+    ExecCVarRestrictions,
+    ReadOnlyCvar,
+    idCmdSystem,
+    SetCVar,
+    LevelLoadCompleted,
+    CutsceneFOV,
+    CutsceneFrameGen,
+    CutsceneFramerate,
+    FrameTiming,
+    Count
+};
+
+struct SignatureVariant
+{
+    Sig sig;
+    const char* version;            // Game version the variant was added for, nullptr for the original
+    Memory::Signature signature;
+    std::ptrdiff_t offset;          // From the start of the match to the patched or hooked instruction
+    std::string_view patch;         // Bytes written at offset, empty for hooks
+    std::uint32_t timestamp;        // Exe TimeDateStamp the variant is known to match, 0 if not recorded.
+                                    // When one is recorded for the running exe, the other variants are only scanned if it misses.
+};
+
+constexpr auto SignatureTable = std::to_array<SignatureVariant>({
+    { Sig::SkipIntroVideo, nullptr, "0F 95 ?? ?? ?? FF 15 ?? ?? ?? ?? 48 8B ?? ?? 48 8D ?? ?? ?? ?? ??", 0x0, {}, 0 },
+    { Sig::ConsoleCVarRestrictions, nullptr, "08 4C 8B 0E BA 01", 0x5, { "\x00\x00\x00\x00", 4 }, 0 },
+    { Sig::BindCVarRestrictions, nullptr, "BA 01 00 00 00 49 ?? ?? 8B ?? 41 FF ?? ?? 8B ?? 8B ?? E8 ?? ?? ?? ??", 0x1, { "\x00\x00\x00\x00", 4 }, 0 },
+    { Sig::ExecCVarRestrictions, nullptr, "BA 01 00 00 00 E8 ?? ?? ?? ?? 83 ?? ?? ?? ?? ?? 00 0F 84 ?? ?? ?? ??", 0x1, { "\x00\x00\x00\x00", 4 }, 0 },
+    { Sig::ReadOnlyCvar, nullptr, "0F ?? ?? 0E 73 ?? 48 8B ?? ?? 48 8D ?? ?? ?? ?? ?? E8 ?? ?? ?? ??", 0x0, {}, 0 },
+    { Sig::idCmdSystem, nullptr, "48 8D ?? ?? ?? ?? ?? 48 89 ?? ?? ?? ?? ?? 48 89 ?? ?? E8 ?? ?? ?? ?? 48 8B ?? ?? ?? ?? ?? 48 8D ?? ?? ?? ?? ?? B9 00 01 00 00", 0x0, {}, 0 },
+    { Sig::SetCVar, nullptr, "40 ?? 53 41 ?? 48 8D ?? ?? ?? 48 81 ?? ?? ?? ?? ?? 48 8B ?? ?? ?? ?? ?? 48 33 ?? 48 89 ?? ?? 8B ?? 4C 8B ??", 0x0, {}, 0 },
+    { Sig::LevelLoadCompleted, nullptr, "48 89 ?? ?? ?? 48 89 ?? ?? ?? 48 89 ?? ?? ?? 57 48 83 ?? ?? 48 8D ?? ?? ?? ?? ?? E8 ?? ?? ?? ??", 0x0, {}, 0 },
+    { Sig::CutsceneFOV, nullptr, "83 ?? ?? ?? 02 0F 28 ?? 48 8B ?? ?? ?? 0F 57 ?? F3 0F ?? ?? F3 0F ?? ?? ?? ?? ?? ??", 0x8, {}, 0 },
+    { Sig::CutsceneFrameGen, nullptr, "38 5F 5B 0F 85 ?? ?? ?? ?? 48", 0x5, { "\x00\x00\x00\x00", 4 }, 0 },
+    { Sig::CutsceneFrameGen, "Update 3", "38 9F 87 00 00 00 0F 85 ?? ?? ?? ?? 48", 0x8, { "\x00\x00\x00\x00", 4 }, 0 },
+    { Sig::CutsceneFramerate, nullptr, "48 8B 41 28 48 8B 90 08 03 00 00", 0x4, { "\x48\x31\xD2\x90\x90\x90\x90", 7 }, 0 },
+    { Sig::CutsceneFramerate, "Update 2", "48 8B 41 28 48 39 98 08 03 00 00 75 1C", 0xB, { "\x90\x90", 2 }, 0 },   // Extra checks around the patch
+    { Sig::FrameTiming, nullptr, "48 8B 41 28 48 8B 90 08 03 00 00", 0x0, {}, 0 },
+    { Sig::FrameTiming, "Update 2", "48 8B 41 28 48 39 98 08 03 00 00 75 1C", 0x0, {}, 0 }
+});
+
+constexpr std::array<const char*, (std::size_t)Sig::Count> SignatureNames = {
+    "SkipIntroVideo",
+    "ConsoleCVarRestrictions",
+    "BindCVarRestrictions",
+    "ExecCVarRestrictions",
+    "ReadOnlyCvar",
+    "idCmdSystem",
+    "SetCVar",
+    "LevelLoadCompleted",
+    "CutsceneFOV",
+    "CutsceneFrameGen",
+    "CutsceneFramerate",
+    "FrameTiming"
+};
@@ -1,9 +1,21 @@
 #pragma once
 
 #define WIN32_LEAN_AND_MEAN
+#define NOMINMAX
 
 #include <cassert>
+#include <climits>
 #include <windows.h>
 #include <fstream>
 #include <filesystem>
 #include <iostream>
+#include <sstream>
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <span>
+#include <vector>
+#include <chrono>
+#include <thread>
+#include <mutex>
+#include <unordered_map>
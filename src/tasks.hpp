@@ -0,0 +1,100 @@
+#pragma once
+
+#include "timeline.hpp"
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace Tasks
+{
+    // Dependency graph of startup tasks run on a small thread pool.
+    // A task starts as soon as everything it depends on has finished. Critical tasks jump ahead of anything else that's ready.
+    // Every task is a span on the startup timeline.
+    class TaskGraph
+    {
+    public:
+        using TaskId = std::size_t;
+
+        TaskId Add(const char* name, std::function<void()> function, std::initializer_list<TaskId> dependencies = {}, bool critical = false)
+        {
+            TaskId id = tasks.size();
+            tasks.push_back({ name, std::move(function), {}, dependencies.size(), critical });
+            for (auto dependency : dependencies)
+                tasks[dependency].dependents.push_back(id);
+            return id;
+        }
+
+        // Runs every task and returns once they've all finished. The calling thread is one of the workers.
+        void Run(std::size_t threadCount)
+        {
+            for (TaskId id = 0; id < tasks.size(); ++id) {
+                if (tasks[id].pending == 0)
+                    Enqueue(id);
+            }
+            remaining = tasks.size();
+
+            std::vector<std::thread> threads;
+            for (std::size_t i = 1; i < threadCount; ++i)
+                threads.emplace_back(&TaskGraph::Worker, this);
+            Worker();
+            for (auto& thread : threads)
+                thread.join();
+        }
+
+    private:
+        struct Task
+        {
+            const char* name;
+            std::function<void()> function;
+            std::vector<TaskId> dependents;
+            std::size_t pending;
+            bool critical;
+        };
+
+        // Must hold mutex, or be called before any workers start
+        void Enqueue(TaskId id)
+        {
+            if (tasks[id].critical)
+                ready.push_front(id);
+            else
+                ready.push_back(id);
+        }
+
+        void Worker()
+        {
+            std::unique_lock lock(mutex);
+            while (true) {
+                wake.wait(lock, [this] { return !ready.empty() || remaining == 0; });
+                if (remaining == 0)
+                    return;
+
+                TaskId id = ready.front();
+                ready.pop_front();
+
+                lock.unlock();
+                {
+                    Timeline::Span span("Task", tasks[id].name);
+                    tasks[id].function();
+                }
+                lock.lock();
+
+                for (auto dependent : tasks[id].dependents) {
+                    if (--tasks[dependent].pending == 0)
+                        Enqueue(dependent);
+                }
+                --remaining;
+                wake.notify_all();
+            }
+        }
+
+        std::vector<Task> tasks;
+        std::deque<TaskId> ready;
+        std::size_t remaining = 0;
+        std::mutex mutex;
+        std::condition_variable wake;
+    };
+}
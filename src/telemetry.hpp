@@ -0,0 +1,252 @@
+#pragma once
+
+#include "platform.hpp"
+#include "timeline.hpp"
+
+#include <spdlog/spdlog.h>
+
+#include <algorithm>
+#include <atomic>
+#include <bit>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <thread>
+
+// Per-hook call counts and latency histograms.
+// Each hook callback opens a Telemetry::Scope on its probe. Timing uses the TSC, and every thread records into its own slot
+// so hooks never share a cache line or take a lock. A background thread sums the slots, logs them every few seconds and
+// publishes them to a named shared-memory block (see SharedStats) for external viewers.
+
+namespace Telemetry
+{
+    constexpr std::size_t MaxProbes = 16;
+    constexpr std::size_t MaxThreads = 32;
+    constexpr std::size_t Buckets = 40;     // Bucket n counts calls that took [2^(n-1), 2^n) ticks
+    constexpr std::uint32_t SharedMagic = 0x4D4C4554;   // "TELM"
+    constexpr std::uint32_t SharedVersion = 1;
+
+    std::atomic<bool> bEnabled = false;
+    const char* ProbeNames[MaxProbes]{};
+    std::size_t ProbeCount = 0;
+
+    struct ProbeStats
+    {
+        std::atomic<std::uint64_t> count;
+        std::atomic<std::uint64_t> totalTicks;
+        std::atomic<std::uint64_t> maxTicks;
+        std::atomic<std::uint64_t> histogram[Buckets];
+    };
+
+    struct alignas(64) ThreadSlot
+    {
+        ProbeStats probes[MaxProbes];
+    };
+
+    // Threads past MaxThreads all share the last slot, which is still correct since every update is an atomic read-modify-write
+    ThreadSlot ThreadSlots[MaxThreads];
+    std::atomic<std::size_t> ThreadSlotsUsed = 0;
+
+    ThreadSlot& CurrentThreadSlot()
+    {
+        thread_local ThreadSlot* slot = &ThreadSlots[std::min(ThreadSlotsUsed.fetch_add(1, std::memory_order_relaxed), MaxThreads - 1)];
+        return *slot;
+    }
+
+    // A named thing to measure, declared once per hook. Probes must be created during static initialisation.
+    // The first call is also marked on the startup timeline, whether or not telemetry is enabled.
+    class Probe
+    {
+    public:
+        explicit Probe(const char* name) : index(ProbeCount), firstCall("First call", name)
+        {
+            if (ProbeCount < MaxProbes)
+                ProbeNames[ProbeCount++] = name;
+        }
+
+        std::size_t Index() const { return index; }
+        void Called() const { firstCall.Hit(); }
+
+    private:
+        std::size_t index;
+        mutable Timeline::Milestone firstCall;
+    };
+
+    // Times the enclosing block against a probe
+    class Scope
+    {
+    public:
+        explicit Scope(const Probe& probe) : index(probe.Index()), start(bEnabled.load(std::memory_order_relaxed) && index < MaxProbes ? __rdtsc() : 0)
+        {
+            probe.Called();
+        }
+
+        ~Scope()
+        {
+            if (!start)
+                return;
+
+            std::uint64_t ticks = __rdtsc() - start;
+            auto& stats = CurrentThreadSlot().probes[index];
+            stats.count.fetch_add(1, std::memory_order_relaxed);
+            stats.totalTicks.fetch_add(ticks, std::memory_order_relaxed);
+            stats.histogram[std::min<std::size_t>(std::bit_width(ticks), Buckets - 1)].fetch_add(1, std::memory_order_relaxed);
+            // Threads sharing the overflow slot can race on the maximum, so only replace a smaller one
+            auto maxTicks = stats.maxTicks.load(std::memory_order_relaxed);
+            while (ticks > maxTicks && !stats.maxTicks.compare_exchange_weak(maxTicks, ticks, std::memory_order_relaxed)) {}
+        }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        std::size_t index;
+        std::uint64_t start;
+    };
+
+    // Layout of the shared-memory block, read by external viewers.
+    // The writer makes sequence odd while it updates the block, so readers retry until they see the same even value
+    // before and after copying it.
+    struct SharedProbe
+    {
+        char name[32];
+        std::uint64_t count;
+        std::uint64_t totalNs;
+        std::uint64_t maxNs;
+        std::uint64_t histogram[Buckets];   // Same buckets as above, in ticks. Multiply by nsPerTick for time.
+    };
+
+    struct SharedStats
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::atomic<std::uint32_t> sequence;
+        std::uint32_t probeCount;
+        double nsPerTick;
+        std::uint64_t uptimeMs;
+        SharedProbe probes[MaxProbes];
+    };
+
+    struct Totals
+    {
+        std::uint64_t count = 0;
+        std::uint64_t totalTicks = 0;
+        std::uint64_t maxTicks = 0;
+        std::uint64_t histogram[Buckets]{};
+    };
+
+    Totals Collect(std::size_t probe)
+    {
+        Totals totals;
+        for (auto& slot : ThreadSlots) {
+            auto& stats = slot.probes[probe];
+            totals.count += stats.count.load(std::memory_order_relaxed);
+            totals.totalTicks += stats.totalTicks.load(std::memory_order_relaxed);
+            totals.maxTicks = std::max(totals.maxTicks, stats.maxTicks.load(std::memory_order_relaxed));
+            for (std::size_t b = 0; b < Buckets; ++b)
+                totals.histogram[b] += stats.histogram[b].load(std::memory_order_relaxed);
+        }
+        return totals;
+    }
+
+    // Upper bound (in ticks) of the bucket containing the given percentile
+    std::uint64_t Percentile(const Totals& totals, double percentile)
+    {
+        auto target = (std::uint64_t)(totals.count * percentile);
+        std::uint64_t seen = 0;
+        for (std::size_t b = 0; b < Buckets; ++b) {
+            seen += totals.histogram[b];
+            if (seen > target)
+                return 1ull << b;
+        }
+        return totals.maxTicks;
+    }
+
+    SharedStats* CreateSharedStats(const std::wstring& name)
+    {
+#ifdef _WIN32
+        HANDLE mapping = CreateFileMappingW(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE, 0, sizeof(SharedStats), name.c_str());
+        if (!mapping)
+            return nullptr;
+
+        // Kept open (and mapped) for the life of the process
+        auto stats = static_cast<SharedStats*>(MapViewOfFile(mapping, FILE_MAP_ALL_ACCESS, 0, 0, sizeof(SharedStats)));
+        if (!stats) {
+            CloseHandle(mapping);
+            return nullptr;
+        }
+        return stats;
+#else
+        (void)name;
+        return nullptr;
+#endif
+    }
+
+    void Publish(SharedStats& shared, double nsPerTick, std::uint64_t uptimeMs)
+    {
+        shared.sequence.fetch_add(1, std::memory_order_acq_rel);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        shared.magic = SharedMagic;
+        shared.version = SharedVersion;
+        shared.probeCount = (std::uint32_t)ProbeCount;
+        shared.nsPerTick = nsPerTick;
+        shared.uptimeMs = uptimeMs;
+        for (std::size_t i = 0; i < ProbeCount; ++i) {
+            auto totals = Collect(i);
+            auto& probe = shared.probes[i];
+            std::strncpy(probe.name, ProbeNames[i], sizeof(probe.name) - 1);
+            probe.count = totals.count;
+            probe.totalNs = (std::uint64_t)(totals.totalTicks * nsPerTick);
+            probe.maxNs = (std::uint64_t)(totals.maxTicks * nsPerTick);
+            std::memcpy(probe.histogram, totals.histogram, sizeof(probe.histogram));
+        }
+
+        shared.sequence.fetch_add(1, std::memory_order_release);
+    }
+
+    void LogStats(double nsPerTick)
+    {
+        for (std::size_t i = 0; i < ProbeCount; ++i) {
+            auto totals = Collect(i);
+            if (totals.count == 0)
+                continue;
+
+            spdlog::info("Telemetry: {}: {} call(s), mean {:.0f}ns, p50 < {:.0f}ns, p99 < {:.0f}ns, max {:.0f}ns", ProbeNames[i], totals.count,
+                totals.totalTicks * nsPerTick / totals.count, Percentile(totals, 0.50) * nsPerTick, Percentile(totals, 0.99) * nsPerTick, totals.maxTicks * nsPerTick);
+        }
+    }
+
+    // Enables the probes and starts the thread that logs and publishes them every logInterval
+    void Start(std::chrono::seconds logInterval, const std::wstring& sharedName)
+    {
+        bEnabled = true;
+
+        SharedStats* shared = CreateSharedStats(sharedName);
+        if (!shared)
+            spdlog::error("Telemetry: Failed to create shared memory stats block.");
+
+        std::thread([logInterval, shared] {
+            // The TSC rate is calibrated against the steady clock over the whole uptime, so it only gets more accurate
+            auto startTime = std::chrono::steady_clock::now();
+            auto startTicks = __rdtsc();
+            auto lastLog = startTime;
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+
+                auto now = std::chrono::steady_clock::now();
+                auto elapsedNs = std::chrono::duration_cast<std::chrono::nanoseconds>(now - startTime).count();
+                double nsPerTick = (double)elapsedNs / (double)(__rdtsc() - startTicks);
+
+                if (shared)
+                    Publish(*shared, nsPerTick, elapsedNs / 1000000);
+
+                if (now - lastLog >= logInterval) {
+                    LogStats(nsPerTick);
+                    lastLog = now;
+                }
+            }
+        }).detach();
+    }
+}
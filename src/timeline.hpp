@@ -0,0 +1,190 @@
+#pragma once
+
+#include "stdafx.h"
+
+#include <spdlog/spdlog.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <string_view>
+#include <thread>
+
+// Startup timeline, from DllMain attaching to each fix being live.
+// Phases (config, scans, hook installs, waits) are recorded as spans and first hook calls as milestones, all timed with
+// QPC relative to DllMain. Recording is a few atomics per event into a fixed buffer, so it's always on. Once startup is
+// done, Write() logs the timeline and saves it as a Chrome trace (open in chrome://tracing or ui.perfetto.dev), then keeps
+// adding milestones that come in later, eg. the first level load.
+// Event names must outlive the process (string literals, or names of global objects).
+
+namespace Timeline
+{
+    constexpr std::size_t MaxEvents = 256;
+
+    struct Event
+    {
+        const char* category;
+        const char* name;
+        std::int64_t start;
+        std::int64_t end;       // Same as start for milestones
+        DWORD thread;
+    };
+
+    Event Events[MaxEvents];
+    std::atomic<std::size_t> EventsReserved = 0;
+    std::atomic<std::size_t> EventsWritten = 0;     // Events [0, EventsWritten) are complete
+    std::atomic<bool> Ready[MaxEvents];
+    std::int64_t Origin = 0;
+    std::int64_t Frequency = 1;
+
+    std::int64_t Now()
+    {
+        LARGE_INTEGER now;
+        QueryPerformanceCounter(&now);
+        return now.QuadPart;
+    }
+
+    // Called first thing in DllMain, everything is relative to this
+    void Begin()
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        Frequency = frequency.QuadPart;
+        Origin = Now();
+    }
+
+    double ToMs(std::int64_t ticks)
+    {
+        return (double)(ticks - Origin) * 1000.0 / (double)Frequency;
+    }
+
+    void Add(const char* category, const char* name, std::int64_t start, std::int64_t end)
+    {
+        auto index = EventsReserved.fetch_add(1, std::memory_order_relaxed);
+        if (index >= MaxEvents)
+            return;
+
+        Events[index] = { category, name, start, end, GetCurrentThreadId() };
+        Ready[index].store(true, std::memory_order_release);
+
+        // Move the written count past every event that's finished, in order
+        auto written = EventsWritten.load(std::memory_order_acquire);
+        while (written < MaxEvents && Ready[written].load(std::memory_order_acquire)) {
+            if (EventsWritten.compare_exchange_weak(written, written + 1, std::memory_order_acq_rel))
+                ++written;
+        }
+    }
+
+    void Mark(const char* category, const char* name)
+    {
+        auto now = Now();
+        Add(category, name, now, now);
+    }
+
+    // Records the enclosing block
+    class Span
+    {
+    public:
+        Span(const char* category, const char* name) : category(category), name(name), start(Now()) {}
+        ~Span() { Add(category, name, start, Now()); }
+
+        Span(const Span&) = delete;
+        Span& operator=(const Span&) = delete;
+
+    private:
+        const char* category;
+        const char* name;
+        std::int64_t start;
+    };
+
+    // Marks the first time something happens, eg. a hook's first call. Later calls are a single relaxed load.
+    class Milestone
+    {
+    public:
+        Milestone(const char* category, const char* name) : category(category), name(name) {}
+
+        void Hit()
+        {
+            if (!hit.load(std::memory_order_relaxed) && !hit.exchange(true, std::memory_order_relaxed))
+                Mark(category, name);
+        }
+
+    private:
+        const char* category;
+        const char* name;
+        std::atomic<bool> hit = false;
+    };
+
+    void AppendEscaped(std::string& out, std::string_view text)
+    {
+        for (char c : text) {
+            if (c == '"' || c == '\\')
+                out += '\\';
+            if ((unsigned char)c >= 0x20)
+                out += c;
+        }
+    }
+
+    // Chrome trace event format, times in microseconds
+    bool WriteTrace(const std::filesystem::path& path, std::size_t count)
+    {
+        std::string json = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+        json += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Startup\"}}";
+        for (std::size_t i = 0; i < count; ++i) {
+            const auto& event = Events[i];
+            json += ",\n{\"name\":\"";
+            AppendEscaped(json, event.name);
+            json += "\",\"cat\":\"";
+            AppendEscaped(json, event.category);
+            if (event.end == event.start)
+                json += fmt::format("\",\"ph\":\"i\",\"s\":\"g\",\"ts\":{:.1f},\"pid\":1,\"tid\":{}}}", ToMs(event.start) * 1000.0, event.thread);
+            else
+                json += fmt::format("\",\"ph\":\"X\",\"ts\":{:.1f},\"dur\":{:.1f},\"pid\":1,\"tid\":{}}}", ToMs(event.start) * 1000.0, (ToMs(event.end) - ToMs(event.start)) * 1000.0, event.thread);
+        }
+        json += "\n]}\n";
+
+        std::ofstream file(path, std::ios::binary | std::ios::trunc);
+        file << json;
+        return file.good();
+    }
+
+    void Log(std::size_t begin, std::size_t end)
+    {
+        for (std::size_t i = begin; i < end; ++i) {
+            const auto& event = Events[i];
+            if (event.end == event.start)
+                spdlog::info("Timeline: {:9.2f}ms  {:s}: {:s}", ToMs(event.start), event.category, event.name);
+            else
+                spdlog::info("Timeline: {:9.2f}ms  {:s}: {:s} ({:.2f}ms)", ToMs(event.start), event.category, event.name, ToMs(event.end) - ToMs(event.start));
+        }
+    }
+
+    // Logs and saves what's been recorded so far, then keeps saving as later events come in, for up to followFor
+    void Write(const std::filesystem::path& path, std::chrono::seconds followFor)
+    {
+        std::thread([path, followFor] {
+            auto stop = std::chrono::steady_clock::now() + followFor;
+            std::size_t logged = 0;
+            bool saved = false;
+            while (true) {
+                auto count = EventsWritten.load(std::memory_order_acquire);
+                if (!saved || count != logged) {
+                    Log(logged, count);
+                    if (!WriteTrace(path, count))
+                        spdlog::error("Timeline: Failed to write {}.", path.string());
+                    else if (!saved)
+                        spdlog::info("Timeline: Saved startup trace to {}.", path.string());
+                    saved = true;
+                    logged = count;
+                }
+
+                if (std::chrono::steady_clock::now() >= stop || logged >= MaxEvents)
+                    break;
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+            }
+        }).detach();
+    }
+}
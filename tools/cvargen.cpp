@@ -0,0 +1,177 @@
+// cvargen: generates src/cvarcatalog_table.hpp from cvardump.txt.
+//
+// Each line of the dump is "name: default: help". Every cvar's type is inferred from its default, and the names are
+// laid out in a minimal perfect hash table using CVarCatalog::Hash() from src/cvarcatalog.hpp.
+// The output is committed, so run it by hand whenever cvardump.txt or the hash changes:
+//   g++ -std=c++20 -O2 -Isrc tools/cvargen.cpp -o cvargen
+//   cvargen cvardump.txt src/cvarcatalog_table.hpp
+
+#define CVARGEN
+#include "cvarcatalog.hpp"
+
+#include <algorithm>
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <vector>
+
+struct Record
+{
+    std::string name;
+    std::string defaultValue;
+    CVarCatalog::Type type;
+};
+
+static std::string Trim(const std::string& text)
+{
+    auto begin = text.find_first_not_of(" \t\r");
+    if (begin == std::string::npos)
+        return {};
+    auto end = text.find_last_not_of(" \t\r");
+    return text.substr(begin, end - begin + 1);
+}
+
+static std::string Escape(const std::string& text)
+{
+    std::string escaped;
+    for (char c : text) {
+        if (c == '"' || c == '\\')
+            escaped += '\\';
+        escaped += c;
+    }
+    return escaped;
+}
+
+static const char* TypeEnumName(CVarCatalog::Type type)
+{
+    switch (type) {
+    case CVarCatalog::Type::Int: return "Type::Int";
+    case CVarCatalog::Type::Float: return "Type::Float";
+    default: return "Type::String";
+    }
+}
+
+static bool ReadDump(const char* fileName, std::vector<Record>& records)
+{
+    std::ifstream file(fileName);
+    if (!file) {
+        std::printf("Could not open %s\n", fileName);
+        return false;
+    }
+
+    std::string line;
+    std::getline(file, line);   // "CVar: Default value: Help"
+    while (std::getline(file, line)) {
+        auto nameEnd = line.find(':');
+        if (nameEnd == std::string::npos || nameEnd == 0)
+            continue;
+
+        // Defaults can contain ':' (eg. URLs), but not ": "
+        Record record;
+        record.name = Trim(line.substr(0, nameEnd));
+        auto valueEnd = line.find(": ", nameEnd + 1);
+        record.defaultValue = Trim(line.substr(nameEnd + 1, valueEnd == std::string::npos ? std::string::npos : valueEnd - nameEnd - 1));
+        record.type = CVarCatalog::TypeOf(record.defaultValue);
+
+        bool duplicate = std::any_of(records.begin(), records.end(), [&](const Record& other) { return CVarCatalog::EqualsIgnoreCase(other.name, record.name); });
+        if (duplicate)
+            std::printf("Skipping duplicate cvar %s\n", record.name.c_str());
+        else
+            records.push_back(std::move(record));
+    }
+    return !records.empty();
+}
+
+// Hash and displace: buckets are placed largest first, each searching for a seed that maps all of its names to free slots
+static bool BuildTable(const std::vector<Record>& records, std::vector<std::uint16_t>& seeds, std::vector<std::size_t>& slots)
+{
+    std::size_t count = records.size();
+    std::size_t bucketCount = std::max<std::size_t>(count / 4, 1);
+
+    std::vector<std::vector<std::size_t>> buckets(bucketCount);
+    for (std::size_t i = 0; i < count; ++i)
+        buckets[CVarCatalog::Hash(records[i].name, 0) % bucketCount].push_back(i);
+
+    std::vector<std::size_t> order(bucketCount);
+    for (std::size_t b = 0; b < bucketCount; ++b)
+        order[b] = b;
+    std::stable_sort(order.begin(), order.end(), [&](std::size_t a, std::size_t b) { return buckets[a].size() > buckets[b].size(); });
+
+    seeds.assign(bucketCount, 0);
+    slots.assign(count, SIZE_MAX);
+    std::vector<bool> used(count, false);
+    for (auto b : order) {
+        const auto& bucket = buckets[b];
+        if (bucket.empty())
+            break;
+
+        bool placed = false;
+        for (std::uint32_t seed = 1; seed <= 0xFFFF && !placed; ++seed) {
+            std::vector<std::size_t> candidate;
+            for (auto record : bucket) {
+                auto slot = CVarCatalog::Hash(records[record].name, seed) % count;
+                if (used[slot] || std::find(candidate.begin(), candidate.end(), slot) != candidate.end())
+                    break;
+                candidate.push_back(slot);
+            }
+            if (candidate.size() != bucket.size())
+                continue;
+
+            for (std::size_t i = 0; i < bucket.size(); ++i) {
+                used[candidate[i]] = true;
+                slots[candidate[i]] = bucket[i];
+            }
+            seeds[b] = (std::uint16_t)seed;
+            placed = true;
+        }
+        if (!placed) {
+            std::printf("Could not place hash bucket %zu\n", b);
+            return false;
+        }
+    }
+    return true;
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 3) {
+        std::printf("Usage: cvargen <cvardump.txt> <output header>\n");
+        return 1;
+    }
+
+    std::vector<Record> records;
+    if (!ReadDump(argv[1], records))
+        return 1;
+
+    std::vector<std::uint16_t> seeds;
+    std::vector<std::size_t> slots;
+    if (!BuildTable(records, seeds, slots))
+        return 1;
+
+    std::ofstream out(argv[2], std::ios::binary | std::ios::trunc);
+    if (!out) {
+        std::printf("Could not write %s\n", argv[2]);
+        return 1;
+    }
+
+    out << "// Generated from cvardump.txt by tools/cvargen.cpp, do not edit.\n";
+    out << "#pragma once\n\n";
+    out << "namespace CVarCatalog\n{\n";
+    out << "    constexpr std::size_t Count = " << records.size() << ";\n";
+    out << "    constexpr std::size_t BucketCount = " << seeds.size() << ";\n\n";
+
+    out << "    constexpr std::uint16_t Seeds[BucketCount] = {";
+    for (std::size_t b = 0; b < seeds.size(); ++b)
+        out << (b % 16 == 0 ? "\n        " : " ") << seeds[b] << ",";
+    out << "\n    };\n\n";
+
+    out << "    constexpr Entry Entries[Count] = {\n";
+    for (auto record : slots) {
+        const auto& r = records[record];
+        out << "        { \"" << Escape(r.name) << "\", " << TypeEnumName(r.type) << ", \"" << Escape(r.defaultValue) << "\" },\n";
+    }
+    out << "    };\n}\n";
+
+    std::printf("Generated %zu cvars in %zu buckets.\n", records.size(), seeds.size());
+    return 0;
+}
@@ -0,0 +1,179 @@
+// cvarsend: sends cvar batches to the game through the command channel in src/commandring.hpp.
+//
+// Every name=value argument goes into one batch, which the game applies all together on one frame. With --every, the
+// batches given with --alternate are sent in turn every few seconds, for A/B comparisons while a capture runs.
+// --test runs a writer and a reader on an in-process ring instead, checking batches arrive whole, in order and once.
+//
+// Build:
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\cvarsend.cpp
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/cvarsend.cpp -o cvarsend     (--test only)
+//
+// Usage:
+//   cvarsend name=value [name=value ...]
+//   cvarsend --every <seconds> --alternate "name=a name2=b" "name=c name2=d" [...]
+//   cvarsend --test
+
+#include "commandring.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+using Batch = std::vector<std::pair<std::string_view, std::string_view>>;
+
+bool ParseAssignment(std::string_view text, Batch& batch)
+{
+    auto equals = text.find('=');
+    if (equals == std::string_view::npos || equals == 0)
+        return false;
+    batch.push_back({ text.substr(0, equals), text.substr(equals + 1) });
+    return true;
+}
+
+// Retries for a while if the game hasn't drained the ring yet
+bool PushWithRetry(Commands::Writer& writer, const Batch& batch)
+{
+    for (int attempt = 0; attempt < 200; ++attempt) {
+        if (writer.Push(batch))
+            return true;
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    }
+    return false;
+}
+
+int SelfTest()
+{
+    auto ring = std::make_unique<Commands::SharedRing>();
+    Commands::InitialiseRing(*ring);
+
+    // Every command of batch n is "batch.n = n", so a reader can tell a batch was split or reordered
+    constexpr std::size_t BatchCount = 200000;
+    std::thread writerThread([&ring] {
+        Commands::Writer writer(*ring);
+        std::mt19937 rng(1);
+        std::vector<std::string> names, values;
+        for (std::size_t n = 0; n < BatchCount; ++n) {
+            std::size_t size = std::uniform_int_distribution<std::size_t>(1, 24)(rng);
+            names.clear();
+            values.clear();
+            for (std::size_t i = 0; i < size; ++i) {
+                names.push_back("batch." + std::to_string(n) + "." + std::to_string(i));
+                values.push_back(std::to_string(n));
+            }
+            Batch batch;
+            for (std::size_t i = 0; i < size; ++i)
+                batch.push_back({ names[i], values[i] });
+            while (!writer.Push(batch))
+                std::this_thread::yield();
+        }
+    });
+
+    Commands::Reader reader(*ring);
+    std::size_t nextBatch = 0, drains = 0, failures = 0, maxDrained = 0;
+    while (nextBatch < BatchCount) {
+        CVarList cvars;
+        auto result = reader.Drain(32, cvars);
+        if (!result.batches) {
+            std::this_thread::yield();
+            continue;
+        }
+        ++drains;
+        maxDrained = std::max(maxDrained, result.commands);
+
+        // Batches come out in order, and nothing is left of a batch once the next one starts
+        std::size_t batch = nextBatch, seen = 0;
+        for (const auto& cvar : cvars.Records()) {
+            auto value = std::strtoull(cvar.value, nullptr, 10);
+            if (value != batch && value == batch + 1) {
+                ++batch;
+            }
+            if (value != batch || std::string_view(cvar.name).rfind("batch." + std::to_string(batch) + ".", 0) != 0)
+                ++failures;
+            ++seen;
+        }
+        if (batch + 1 - nextBatch != result.batches || seen != result.commands)
+            ++failures;
+        nextBatch += result.batches;
+    }
+    writerThread.join();
+
+    std::printf("%zu batches in %zu drains, at most %zu commands per drain, %zu failure(s)\n", BatchCount, drains, maxDrained, failures);
+    return failures ? 1 : 0;
+}
+
+int main(int argc, char** argv)
+{
+    std::vector<std::string_view> args(argv + 1, argv + argc);
+    if (args.size() == 1 && args[0] == "--test")
+        return SelfTest();
+
+#ifdef _WIN32
+    if (args.empty()) {
+        std::fprintf(stderr, "usage: cvarsend name=value [name=value ...]\n"
+                             "       cvarsend --every <seconds> --alternate \"name=a ...\" \"name=b ...\" [...]\n"
+                             "       cvarsend --test\n");
+        return 2;
+    }
+
+    Commands::SharedRing* ring = Commands::OpenSharedRing(L"Local\\GreatCircleFix.Commands");
+    if (!ring) {
+        std::fprintf(stderr, "Couldn't open the command channel. Is the game running with [Command Channel] enabled?\n");
+        return 1;
+    }
+    Commands::Writer writer(*ring);
+
+    // Alternating batches, until interrupted
+    if (args.size() >= 4 && args[0] == "--every" && args[2] == "--alternate") {
+        auto interval = std::chrono::duration<double>(std::atof(std::string(args[1]).c_str()));
+        std::vector<std::vector<std::string>> words;
+        std::vector<Batch> batches;
+        for (std::size_t i = 3; i < args.size(); ++i) {
+            std::istringstream stream{ std::string(args[i]) };
+            auto& batchWords = words.emplace_back();
+            for (std::string word; stream >> word;)
+                batchWords.push_back(word);
+        }
+        for (const auto& batchWords : words) {
+            Batch& batch = batches.emplace_back();
+            for (const auto& word : batchWords) {
+                if (!ParseAssignment(word, batch)) {
+                    std::fprintf(stderr, "Not a name=value assignment: %s\n", word.c_str());
+                    return 2;
+                }
+            }
+        }
+
+        for (std::size_t n = 0;; n = (n + 1) % batches.size()) {
+            if (!PushWithRetry(writer, batches[n])) {
+                std::fprintf(stderr, "The game isn't reading the command channel.\n");
+                return 1;
+            }
+            std::printf("Sent batch %zu\n", n + 1);
+            std::this_thread::sleep_for(interval);
+        }
+    }
+
+    Batch batch;
+    for (auto arg : args) {
+        if (!ParseAssignment(arg, batch)) {
+            std::fprintf(stderr, "Not a name=value assignment: %.*s\n", (int)arg.size(), arg.data());
+            return 2;
+        }
+    }
+    if (!PushWithRetry(writer, batch)) {
+        std::fprintf(stderr, "Couldn't send the batch, a name or value is too long or the game isn't reading the command channel.\n");
+        return 1;
+    }
+    std::printf("Sent %zu cvar(s)\n", batch.size());
+    return 0;
+#else
+    std::fprintf(stderr, "usage: cvarsend --test (sending to the game needs Windows)\n");
+    return 2;
+#endif
+}
@@ -0,0 +1,99 @@
+// fovcheck: checks the cached cutscene FOV transform in src/fov.hpp against the original hor+ formula.
+//
+// Sweeps input FOVs over a range of resolutions (narrower than 16:9, 16:9, ultrawide, super ultrawide, triple screen and
+// portrait), through one FOV::CutsceneFOV like the hook uses, so cache hits, collisions and resolution changes are all
+// covered. Every result must be within MaxUlps of the formula the cutscene FOV fix has always used, and NeedsFix() must
+// agree with whether the aspect ratio is wider than native. Exits with 1 on any failure.
+//
+// Build (Linux or Windows):
+//   g++ -std=c++20 -O2 -Isrc tools/fovcheck.cpp -o fovcheck
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\fovcheck.cpp
+//
+// Usage:
+//   fovcheck
+
+#include "fov.hpp"
+
+#include <bit>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Largest allowed difference from the reference, in units in the last place
+constexpr std::int64_t MaxUlps = 2;
+
+// The fix's original per-frame math, written out independently of FOV::HorPlus()
+float Reference(float fov, float aspectRatio, float nativeAspect)
+{
+    const float fPi = 3.1415926535f;
+    return atanf(tanf(fov * (fPi / 360)) / nativeAspect * aspectRatio) * (360 / fPi);
+}
+
+std::int64_t UlpDistance(float a, float b)
+{
+    if (std::isnan(a) || std::isnan(b))
+        return (std::isnan(a) && std::isnan(b)) ? 0 : INT64_MAX;
+
+    // Maps floats onto integers that are ordered the same way
+    auto ordered = [](float value) {
+        auto bits = (std::int64_t)std::bit_cast<std::int32_t>(value);
+        return bits < 0 ? INT32_MIN - bits : bits;
+    };
+    return std::llabs(ordered(a) - ordered(b));
+}
+
+int main()
+{
+    const float nativeAspect = 16.0f / 9.0f;
+    const int resolutions[][2] = {
+        { 1024, 768 }, { 1280, 1024 }, { 1920, 1200 }, { 1920, 1080 }, { 2560, 1440 }, { 2560, 1080 },
+        { 3440, 1440 }, { 3840, 1600 }, { 5120, 1440 }, { 5760, 1080 }, { 7680, 1440 }, { 1080, 1920 }
+    };
+
+    // A few FOVs a camera might hold across a resolution change. Checked last at one resolution and first at the next, so
+    // they're still cached from the old aspect ratio when the new one starts.
+    const std::vector<float> held = { 40.0f, 55.0f, 60.0f, 70.0f, 75.0f, 90.0f };
+
+    std::vector<float> fovs = held;
+    for (int i = 100; i <= 17900; ++i)
+        fovs.push_back(i / 100.0f);
+    std::mt19937 rng(3);
+    for (int i = 0; i < 20000; ++i)
+        fovs.push_back(std::uniform_real_distribution<float>(1.0f, 179.0f)(rng));
+    fovs.insert(fovs.end(), held.begin(), held.end());
+
+    FOV::CutsceneFOV transform(nativeAspect);
+    std::size_t checked = 0, failures = 0;
+    std::int64_t worstUlps = 0;
+    float worstDegrees = 0.0f;
+
+    // Twice through, so the second pass hits whatever the first left in the cache
+    for (int pass = 0; pass < 2; ++pass) {
+        for (const auto& resolution : resolutions) {
+            transform.SetResolution(resolution[0], resolution[1]);
+            float aspectRatio = (float)resolution[0] / (float)resolution[1];
+            if (transform.NeedsFix() != (aspectRatio > nativeAspect)) {
+                std::printf("NeedsFix() is wrong for %dx%d\n", resolution[0], resolution[1]);
+                ++failures;
+            }
+
+            for (float fov : fovs) {
+                float expected = Reference(fov, aspectRatio, nativeAspect);
+                float actual = transform.Transform(fov);
+                auto ulps = UlpDistance(expected, actual);
+                worstUlps = std::max(worstUlps, ulps);
+                worstDegrees = std::max(worstDegrees, std::fabs(expected - actual));
+                if (ulps > MaxUlps && ++failures <= 10)
+                    std::printf("%dx%d, FOV %.9g: expected %.9g, got %.9g (%lld ulps)\n", resolution[0], resolution[1], fov, expected, actual, (long long)ulps);
+                ++checked;
+            }
+        }
+    }
+
+    std::printf("%zu FOV(s) checked, worst %lld ulp(s) (%g degrees) against a bound of %lld, %zu failure(s)\n",
+        checked, (long long)worstUlps, worstDegrees, (long long)MaxUlps, failures);
+    return failures ? 1 : 0;
+}
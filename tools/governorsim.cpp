@@ -0,0 +1,76 @@
+// governorsim: replays a recorded frame-time trace through the quality governor in src/governor.hpp.
+//
+// The trace is a text file with one frame per line, and the frame time in milliseconds as the last comma-separated field
+// (so plain lists of frame times and Frame Capture CSVs both work, header lines are skipped). Prints every level change
+// and how many frames ran at each level, so changes to the control logic or its settings can be checked against real
+// captures without running the game.
+//
+// Build (Linux or Windows):
+//   g++ -std=c++20 -O2 -Isrc tools/governorsim.cpp -o governorsim
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\governorsim.cpp
+//
+// Usage:
+//   governorsim trace.csv [target fps] [levels]
+
+#include "governor.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <string>
+#include <vector>
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::printf("Usage: governorsim <trace> [target fps] [levels]\n");
+        return 1;
+    }
+
+    std::ifstream file(argv[1]);
+    if (!file) {
+        std::printf("Could not open %s\n", argv[1]);
+        return 1;
+    }
+
+    float targetFPS = argc > 2 ? std::strtof(argv[2], nullptr) : 60.0f;
+    std::size_t levels = argc > 3 ? std::strtoul(argv[3], nullptr, 10) : 3;
+    if (targetFPS <= 0.0f || levels == 0) {
+        std::printf("Target fps and levels must be positive\n");
+        return 1;
+    }
+
+    Governor::Settings settings;
+    settings.targetFrameMs = 1000.0f / targetFPS;
+    Governor::Controller governor(settings, levels);
+
+    std::vector<std::size_t> framesAtLevel(levels + 1, 0);
+    std::vector<std::size_t> slowFramesAtLevel(levels + 1, 0);
+    std::size_t frame = 0;
+    std::size_t changes = 0;
+    std::string line;
+    while (std::getline(file, line)) {
+        auto field = line.c_str() + (line.rfind(',') == std::string::npos ? 0 : line.rfind(',') + 1);
+        char* end;
+        float frameMs = std::strtof(field, &end);
+        if (end == field)
+            continue;
+
+        auto level = governor.Level();
+        ++framesAtLevel[level];
+        if (frameMs > settings.targetFrameMs)
+            ++slowFramesAtLevel[level];
+
+        if (auto newLevel = governor.AddFrame(frameMs)) {
+            std::printf("Frame %8zu: level %zu -> %zu\n", frame, level, *newLevel);
+            ++changes;
+        }
+        ++frame;
+    }
+
+    std::printf("\n%zu frames, %zu level change(s), target %.2fms\n\n", frame, changes, settings.targetFrameMs);
+    std::printf("%-6s %10s %14s\n", "Level", "Frames", "Over target");
+    for (std::size_t i = 0; i <= levels; ++i)
+        std::printf("%-6zu %10zu %14zu\n", i, framesAtLevel[i], slowFramesAtLevel[i]);
+    return 0;
+}
@@ -0,0 +1,256 @@
+// hookreplay: replays a hook trace recorded by the game ([Hook Trace] in the ini) through the hook code in src/hooks.hpp.
+//
+// Every call's recorded input registers go through the current hook code, and the outputs are compared with what the game
+// produced when it recorded the trace. Timing is over the whole trace, repeated, plus a per-call distribution.
+// Outputs can be saved and compared against another build's, to check a change to a hook doesn't change its results.
+// With no trace, replays a synthetic cutscene FOV trace (cameras holding an FOV for a while, the odd resolution change).
+//
+// Build (Linux or Windows):
+//   g++ -std=c++20 -O2 -Isrc tools/hookreplay.cpp -o hookreplay
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\hookreplay.cpp
+//
+// Usage:
+//   hookreplay [trace] [--repeat n] [--save outputs] [--compare outputs]
+
+#include "hooks.hpp"
+#include "hooktrace.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Same member names as SafetyHookContext, for the registers the hooks use
+struct ReplayContext
+{
+    struct Xmm
+    {
+        float f32[4];
+    };
+
+    std::uint64_t rax;
+    std::uint64_t rflags;
+    Xmm xmm1;
+    Xmm xmm2;
+    Xmm xmm3;
+};
+
+// Runs every record's inputs through the hook, with fresh hook state, writing the outputs
+template<typename Hook>
+void Replay(const std::vector<HookTrace::Record>& records, std::vector<HookTrace::Registers>& outputs, Hook hook)
+{
+    ReplayContext ctx{};
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        HookTrace::Restore(records[i].before, ctx);
+        hook(ctx);
+        outputs[i] = HookTrace::Capture(ctx);
+    }
+}
+
+// Times each call on its own, so includes the clock's overhead
+template<typename Hook>
+std::vector<double> TimeCalls(const std::vector<HookTrace::Record>& records, Hook hook)
+{
+    std::vector<double> callNs;
+    ReplayContext ctx{};
+    for (const auto& record : records) {
+        HookTrace::Restore(record.before, ctx);
+        auto start = std::chrono::steady_clock::now();
+        hook(ctx);
+        callNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count());
+    }
+    return callNs;
+}
+
+// Calls f with the trace's hook as the game runs it, starting from the state it had when recording started
+template<typename F>
+bool WithHook(const HookTrace::Header& header, F f)
+{
+    switch (header.hook) {
+    case HookTrace::Hook::ReadOnlyCvar:
+        f([](ReplayContext& ctx) { Hooks::ReadOnlyCvar(ctx); });
+        return true;
+    case HookTrace::Hook::CutsceneFOV: {
+        FOV::CutsceneFOV transform(header.nativeAspect);
+        transform.SetResolution(header.resX, header.resY);
+        f([&transform](ReplayContext& ctx) { Hooks::CutsceneFOV(transform, ctx); });
+        return true;
+    }
+    default:
+        return false;
+    }
+}
+
+bool SameRegisters(const HookTrace::Registers& a, const HookTrace::Registers& b)
+{
+    // Bit for bit, so NaNs compare equal to themselves and -0 differs from 0
+    return a.rax == b.rax && a.rflags == b.rflags && std::bit_cast<std::uint32_t>(a.xmm1) == std::bit_cast<std::uint32_t>(b.xmm1) &&
+        std::bit_cast<std::uint32_t>(a.xmm2) == std::bit_cast<std::uint32_t>(b.xmm2) && std::bit_cast<std::uint32_t>(a.xmm3) == std::bit_cast<std::uint32_t>(b.xmm3);
+}
+
+void PrintRegisters(const char* label, const HookTrace::Registers& registers)
+{
+    std::printf("    %-9s rax=%016llx rflags=%016llx xmm1=%g xmm2=%g xmm3=%.9g\n", label, (unsigned long long)registers.rax, (unsigned long long)registers.rflags,
+        registers.xmm1, registers.xmm2, registers.xmm3);
+}
+
+// Prints the first few calls where two sets of outputs differ, returns how many do
+std::size_t Diff(const char* description, const std::vector<HookTrace::Record>& records, const std::vector<HookTrace::Registers>& expected, const std::vector<HookTrace::Registers>& actual)
+{
+    std::size_t differences = 0;
+    for (std::size_t i = 0; i < records.size(); ++i) {
+        if (SameRegisters(expected[i], actual[i]))
+            continue;
+        if (++differences <= 5) {
+            std::printf("  Call %zu differs %s:\n", i, description);
+            PrintRegisters("input", records[i].before);
+            PrintRegisters("expected", expected[i]);
+            PrintRegisters("replayed", actual[i]);
+        }
+    }
+    std::printf("%zu of %zu call(s) differ %s\n", differences, records.size(), description);
+    return differences;
+}
+
+std::vector<HookTrace::Record> SyntheticTrace(HookTrace::Header& header)
+{
+    header = { HookTrace::Magic, HookTrace::Version, HookTrace::Hook::CutsceneFOV, sizeof(HookTrace::Record), 0, 16.0f / 9.0f, 3440, 1440, 0 };
+
+    std::mt19937 rng(7);
+    std::vector<HookTrace::Record> records;
+    FOV::CutsceneFOV transform(header.nativeAspect);
+    transform.SetResolution(header.resX, header.resY);
+
+    float resX = 3440.0f, resY = 1440.0f, fov = 60.0f;
+    for (std::size_t i = 0; i < 200000; ++i) {
+        if (std::uniform_int_distribution<int>(0, 20000)(rng) == 0) {
+            static const float resolutions[][2] = { { 3440, 1440 }, { 2560, 1440 }, { 5120, 1440 }, { 1920, 1080 } };
+            auto& resolution = resolutions[std::uniform_int_distribution<int>(0, 3)(rng)];
+            resX = resolution[0];
+            resY = resolution[1];
+        }
+        if (std::uniform_int_distribution<int>(0, 120)(rng) == 0)
+            fov = std::uniform_real_distribution<float>(30.0f, 90.0f)(rng);
+
+        ReplayContext ctx{};
+        ctx.rax = std::uniform_int_distribution<int>(0, 50)(rng) == 0 ? 1 : 0;
+        ctx.rflags = 0x202;
+        ctx.xmm1.f32[0] = resX;
+        ctx.xmm2.f32[0] = resY;
+        ctx.xmm3.f32[0] = fov;
+
+        HookTrace::Record record;
+        record.before = HookTrace::Capture(ctx);
+        Hooks::CutsceneFOV(transform, ctx);
+        record.after = HookTrace::Capture(ctx);
+        records.push_back(record);
+    }
+    header.recordCount = records.size();
+    return records;
+}
+
+bool SaveOutputs(const std::string& path, const std::vector<HookTrace::Registers>& outputs)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+    file.write(reinterpret_cast<const char*>(outputs.data()), (std::streamsize)(outputs.size() * sizeof(HookTrace::Registers)));
+    return file.good();
+}
+
+bool LoadOutputs(const std::string& path, std::vector<HookTrace::Registers>& outputs)
+{
+    std::ifstream file(path, std::ios::binary);
+    return file && file.read(reinterpret_cast<char*>(outputs.data()), (std::streamsize)(outputs.size() * sizeof(HookTrace::Registers))) && file.peek() == EOF;
+}
+
+int main(int argc, char** argv)
+{
+    std::string tracePath, savePath, comparePath;
+    std::size_t repeat = 20;
+    for (int i = 1; i < argc; ++i) {
+        std::string_view arg = argv[i];
+        if (arg == "--repeat" && i + 1 < argc)
+            repeat = std::max(std::strtoull(argv[++i], nullptr, 10), 1ull);
+        else if (arg == "--save" && i + 1 < argc)
+            savePath = argv[++i];
+        else if (arg == "--compare" && i + 1 < argc)
+            comparePath = argv[++i];
+        else if (tracePath.empty() && !arg.starts_with("--"))
+            tracePath = arg;
+        else {
+            std::fprintf(stderr, "usage: hookreplay [trace] [--repeat n] [--save outputs] [--compare outputs]\n");
+            return 2;
+        }
+    }
+
+    HookTrace::Header header;
+    std::vector<HookTrace::Record> records;
+    if (tracePath.empty()) {
+        records = SyntheticTrace(header);
+        std::printf("Synthetic cutscene FOV trace, %zu call(s)\n", records.size());
+    }
+    else if (!HookTrace::Load(tracePath, header, records)) {
+        std::fprintf(stderr, "Couldn't read a hook trace from %s\n", tracePath.c_str());
+        return 1;
+    }
+    else {
+        std::printf("%s: %zu call(s)\n", tracePath.c_str(), records.size());
+    }
+
+    std::vector<HookTrace::Registers> outputs(records.size());
+    auto start = std::chrono::steady_clock::now();
+    for (std::size_t pass = 0; pass < repeat; ++pass) {
+        if (!WithHook(header, [&](auto hook) { Replay(records, outputs, hook); })) {
+            std::fprintf(stderr, "Unknown hook %u in trace\n", (unsigned)header.hook);
+            return 1;
+        }
+    }
+    double totalNs = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+    std::vector<double> callNs;
+    WithHook(header, [&](auto hook) { callNs = TimeCalls(records, hook); });
+    std::vector<double> clockNs;
+    for (std::size_t i = 0; i < std::min<std::size_t>(records.size(), 100000); ++i) {
+        auto clockStart = std::chrono::steady_clock::now();
+        clockNs.push_back(std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - clockStart).count());
+    }
+
+    auto percentile = [](std::vector<double>& values, double p) {
+        if (values.empty())
+            return 0.0;
+        auto nth = values.begin() + (std::ptrdiff_t)((values.size() - 1) * p);
+        std::nth_element(values.begin(), nth, values.end());
+        return *nth;
+    };
+    double clockOverhead = percentile(clockNs, 0.5);
+    if (!records.empty()) {
+        std::printf("Mean %.2fns per call over %zu pass(es)\n", totalNs / (double)(records.size() * repeat), repeat);
+        std::printf("Per call, less %.1fns of clock overhead: p50 %.1fns, p99 %.1fns, p99.9 %.1fns, max %.1fns\n", clockOverhead,
+            std::max(percentile(callNs, 0.5) - clockOverhead, 0.0), std::max(percentile(callNs, 0.99) - clockOverhead, 0.0),
+            std::max(percentile(callNs, 0.999) - clockOverhead, 0.0), std::max(percentile(callNs, 1.0) - clockOverhead, 0.0));
+    }
+
+    std::vector<HookTrace::Registers> recorded(records.size());
+    std::transform(records.begin(), records.end(), recorded.begin(), [](const HookTrace::Record& record) { return record.after; });
+    std::size_t differences = Diff("from the recording", records, recorded, outputs);
+
+    if (!comparePath.empty()) {
+        std::vector<HookTrace::Registers> other(records.size());
+        if (!LoadOutputs(comparePath, other)) {
+            std::fprintf(stderr, "Couldn't read %zu call(s) of outputs from %s\n", records.size(), comparePath.c_str());
+            return 1;
+        }
+        differences += Diff(("from " + comparePath).c_str(), records, other, outputs);
+    }
+
+    if (!savePath.empty() && !SaveOutputs(savePath, outputs)) {
+        std::fprintf(stderr, "Couldn't write %s\n", savePath.c_str());
+        return 1;
+    }
+    return differences ? 1 : 0;
+}
@@ -0,0 +1,122 @@
+// pacersim: runs the frame limiter's pacer from src/pacer.hpp against a simulated clock.
+//
+// Each simulated frame does some work, then waits on the pacer. Sleeps wake late by a random amount up to the given
+// jitter (about 0.5ms with a high resolution timer, 1-2ms without), so the spin margin can be checked against both.
+// Work times come from a trace file (frame time in milliseconds as the last comma-separated field, so Frame Capture CSVs
+// work, header lines are skipped), or are random around half the target if no trace is given.
+//
+// Build (Linux or Windows):
+//   g++ -std=c++20 -O2 -Isrc tools/pacersim.cpp -o pacersim
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\pacersim.cpp
+//
+// Usage:
+//   pacersim [target fps] [sleep jitter ms] [trace]
+
+#include "pacer.hpp"
+
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <random>
+#include <string>
+#include <vector>
+
+struct SimulatedClock
+{
+    double now = 0.0;
+    double sleepJitterMs = 1.0;
+    double sleptMs = 0.0;
+    std::size_t spins = 0;
+    std::mt19937_64 rng{ 42 };
+
+    double Now() const { return now; }
+
+    void Sleep(double ms)
+    {
+        // Late wakes are mostly small with the occasional long one
+        double late = std::pow(std::uniform_real_distribution<double>(0.0, 1.0)(rng), 3.0) * sleepJitterMs;
+        now += ms + late;
+        sleptMs += ms + late;
+    }
+
+    void Spin()
+    {
+        now += 0.0005;
+        ++spins;
+    }
+};
+
+int main(int argc, char** argv)
+{
+    double targetFPS = argc > 1 ? std::strtod(argv[1], nullptr) : 116.0;
+    double jitterMs = argc > 2 ? std::strtod(argv[2], nullptr) : 1.0;
+    if (targetFPS <= 0.0 || jitterMs < 0.0) {
+        std::printf("Usage: pacersim [target fps] [sleep jitter ms] [trace]\n");
+        return 1;
+    }
+
+    Pacing::Settings settings;
+    settings.targetFrameMs = 1000.0 / targetFPS;
+
+    std::vector<double> workMs;
+    if (argc > 3) {
+        std::ifstream file(argv[3]);
+        if (!file) {
+            std::printf("Could not open %s\n", argv[3]);
+            return 1;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            auto field = line.c_str() + (line.rfind(',') == std::string::npos ? 0 : line.rfind(',') + 1);
+            char* end;
+            double frameMs = std::strtod(field, &end);
+            if (end != field && frameMs > 0.0)
+                workMs.push_back(frameMs);
+        }
+    }
+    else {
+        std::mt19937_64 rng(7);
+        std::normal_distribution<double> work(settings.targetFrameMs * 0.5, settings.targetFrameMs * 0.1);
+        for (int i = 0; i < 10000; ++i)
+            workMs.push_back(std::max(work(rng), 0.1));
+    }
+
+    SimulatedClock clock;
+    clock.sleepJitterMs = jitterMs;
+    Pacing::Pacer<SimulatedClock> pacer(clock, settings);
+
+    std::vector<double> intervals;
+    double lastFrame = 0.0;
+    for (std::size_t i = 0; i < workMs.size(); ++i) {
+        clock.now += workMs[i];
+        pacer.Wait();
+        if (i > 0)
+            intervals.push_back(clock.now - lastFrame);
+        lastFrame = clock.now;
+    }
+    if (intervals.empty()) {
+        std::printf("Not enough frames\n");
+        return 1;
+    }
+
+    double total = 0.0;
+    double worstError = 0.0;
+    std::vector<double> errors;
+    for (auto interval : intervals) {
+        total += interval;
+        errors.push_back(std::abs(interval - settings.targetFrameMs));
+        worstError = std::max(worstError, errors.back());
+    }
+    std::sort(errors.begin(), errors.end());
+
+    std::printf("%zu frames, target %.3fms, sleep jitter up to %.2fms\n\n", intervals.size() + 1, settings.targetFrameMs, jitterMs);
+    std::printf("Average interval:   %.3fms (%.2f fps)\n", total / (double)intervals.size(), 1000.0 * (double)intervals.size() / total);
+    std::printf("Median error:       %.4fms\n", errors[errors.size() / 2]);
+    std::printf("99th pct error:     %.4fms\n", errors[std::min(errors.size() - 1, errors.size() * 99 / 100)]);
+    std::printf("Worst error:        %.4fms\n", worstError);
+    std::printf("Late frames:        %zu\n", pacer.LateFrames());
+    std::printf("Spin per frame:     %.3fms (margin now %.3fms)\n", pacer.SpinTotalMs() / (double)intervals.size(), pacer.SpinMarginMs());
+    return 0;
+}
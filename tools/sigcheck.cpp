@@ -0,0 +1,255 @@
+// sigcheck: offline signature validation and scan benchmark.
+//
+// Loads a game executable (or builds a synthetic one) the same way the Windows loader lays it out in memory, then for
+// every signature variant in src/signatures.hpp reports the match count, whether the match is unique and how long it took to find.
+// Signatures that aren't found get their nearest matches listed, with a suggested replacement.
+// Afterwards the old byte-by-byte scanner is benchmarked against each scan engine.
+//
+// Build (Linux or Windows):
+//   g++ -std=c++20 -O2 -pthread -Isrc tools/sigcheck.cpp -o sigcheck
+//   cl /std:c++latest /O2 /EHsc /Isrc tools\sigcheck.cpp
+//
+// Usage:
+//   sigcheck TheGreatCircle.exe
+//   sigcheck --synthetic 400        (400MB synthetic image with each signature planted once)
+
+#include "signatures.hpp"
+#include "approxscan.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+
+using Clock = std::chrono::steady_clock;
+
+// Every variant's pattern, in table order
+static const std::vector<Memory::Signature> Signatures = [] {
+    std::vector<Memory::Signature> signatures;
+    for (const auto& variant : SignatureTable)
+        signatures.push_back(variant.signature);
+    return signatures;
+}();
+
+struct Image
+{
+    std::vector<std::uint8_t> memory;
+    std::uint8_t* base() { return memory.data(); }
+};
+
+static double ElapsedMs(Clock::time_point start)
+{
+    return std::chrono::duration<double, std::milli>(Clock::now() - start).count();
+}
+
+// Maps headers and sections to their virtual addresses, like the loader does
+static bool LoadImage(const char* fileName, Image& image)
+{
+    std::ifstream file(fileName, std::ios::binary);
+    if (!file) {
+        std::printf("Could not open %s\n", fileName);
+        return false;
+    }
+    std::vector<std::uint8_t> raw((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    if (raw.size() < sizeof(IMAGE_DOS_HEADER)) {
+        std::printf("%s is not a PE file\n", fileName);
+        return false;
+    }
+
+    auto dosHeader = (PIMAGE_DOS_HEADER)raw.data();
+    if (dosHeader->e_magic != 0x5A4D || dosHeader->e_lfanew <= 0 || (std::size_t)dosHeader->e_lfanew + sizeof(IMAGE_NT_HEADERS) > raw.size()) {
+        std::printf("%s is not a PE file\n", fileName);
+        return false;
+    }
+
+    auto ntHeaders = (PIMAGE_NT_HEADERS)(raw.data() + dosHeader->e_lfanew);
+    image.memory.assign(ntHeaders->OptionalHeader.SizeOfImage, 0);
+    std::memcpy(image.base(), raw.data(), std::min<std::size_t>(ntHeaders->OptionalHeader.SizeOfHeaders, raw.size()));
+
+    auto section = IMAGE_FIRST_SECTION(ntHeaders);
+    for (WORD i = 0; i < ntHeaders->FileHeader.NumberOfSections; ++i, ++section) {
+        std::size_t size = std::min(section->SizeOfRawData, section->Misc.VirtualSize ? section->Misc.VirtualSize : section->SizeOfRawData);
+        if (section->PointerToRawData + size > raw.size() || section->VirtualAddress + size > image.memory.size())
+            continue;
+        std::memcpy(image.base() + section->VirtualAddress, raw.data() + section->PointerToRawData, size);
+    }
+    return true;
+}
+
+// One executable section of code-like bytes, with every signature planted once at a random offset
+static void BuildSyntheticImage(std::size_t megabytes, Image& image)
+{
+    constexpr std::size_t headerSize = 0x1000;
+    std::size_t textSize = megabytes * 1024 * 1024;
+    image.memory.assign(headerSize + textSize, 0);
+
+    auto dosHeader = (PIMAGE_DOS_HEADER)image.base();
+    dosHeader->e_magic = 0x5A4D;
+    dosHeader->e_lfanew = 0x80;
+
+    auto ntHeaders = (PIMAGE_NT_HEADERS)(image.base() + dosHeader->e_lfanew);
+    ntHeaders->Signature = 0x4550;
+    ntHeaders->FileHeader.NumberOfSections = 1;
+    ntHeaders->FileHeader.SizeOfOptionalHeader = sizeof(ntHeaders->OptionalHeader);
+    ntHeaders->FileHeader.TimeDateStamp = 0x5EED;
+    ntHeaders->OptionalHeader.SizeOfImage = (DWORD)image.memory.size();
+    ntHeaders->OptionalHeader.SizeOfHeaders = headerSize;
+
+    auto section = IMAGE_FIRST_SECTION(ntHeaders);
+    std::memcpy(section->Name, ".text", 5);
+    section->VirtualAddress = headerSize;
+    section->Misc.VirtualSize = (DWORD)textSize;
+    section->SizeOfRawData = (DWORD)textSize;
+    section->Characteristics = IMAGE_SCN_CNT_CODE | IMAGE_SCN_MEM_EXECUTE | IMAGE_SCN_MEM_READ;
+
+    // Bytes weighted by how common they are in real code so anchor selection behaves realistically
+    std::vector<std::uint8_t> pool;
+    for (int b = 0; b < 256; ++b)
+        pool.insert(pool.end(), Memory::ByteFrequency[b] > 1 ? Memory::ByteFrequency[b] / 16 : 1, (std::uint8_t)b);
+
+    std::mt19937_64 rng(1234);
+    auto text = image.base() + headerSize;
+    for (std::size_t i = 0; i < textSize; ++i)
+        text[i] = pool[rng() % pool.size()];
+
+    for (std::size_t k = 0; k < Signatures.size(); ++k) {
+        // Fixes can share a pattern, plant it once
+        const auto& signature = Signatures[k];
+        auto hash = Memory::SignatureHash(signature, Memory::ScanScope::Code);
+        if (std::any_of(Signatures.begin(), Signatures.begin() + k, [hash](const auto& other) { return Memory::SignatureHash(other, Memory::ScanScope::Code) == hash; }))
+            continue;
+
+        auto offset = rng() % (textSize - signature.length);
+        for (std::size_t j = 0; j < signature.length; ++j) {
+            if (signature.mask[j])
+                text[offset + j] = signature.bytes[j];
+        }
+    }
+}
+
+// The scanner as it was before the SIMD engines, kept for comparison
+static const std::uint8_t* LegacyPatternScan(const std::uint8_t* data, std::size_t size, const Memory::Signature& signature)
+{
+    std::vector<int> patternBytes;
+    for (std::size_t j = 0; j < signature.length; ++j)
+        patternBytes.push_back(signature.mask[j] ? signature.bytes[j] : -1);
+
+    auto s = patternBytes.size();
+    auto d = patternBytes.data();
+    for (auto i = 0ul; i < size - s; ++i) {
+        bool found = true;
+        for (auto j = 0ul; j < s; ++j) {
+            if (data[i + j] != d[j] && d[j] != -1) {
+                found = false;
+                break;
+            }
+        }
+        if (found)
+            return &data[i];
+    }
+    return nullptr;
+}
+
+static const char* EngineName(Memory::ScanEngine engine)
+{
+    switch (engine) {
+    case Memory::ScanEngine::AVX2: return "AVX2";
+    case Memory::ScanEngine::SSE2: return "SSE2";
+    default: return "Scalar";
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc < 2) {
+        std::printf("Usage: sigcheck <game exe> | --synthetic <megabytes>\n");
+        return 1;
+    }
+
+    Image image;
+    if (std::strcmp(argv[1], "--synthetic") == 0)
+        BuildSyntheticImage(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 400, image);
+    else if (!LoadImage(argv[1], image))
+        return 1;
+
+    auto module = image.base();
+    auto regions = Memory::GetScanRegions(module, Memory::ScanScope::Code);
+    std::size_t codeSize = 0;
+    for (const auto& region : regions)
+        codeSize += region.size;
+
+    auto detected = Memory::CurrentScanEngine;
+    std::printf("Image: %zu MB, code: %zu MB, timestamp: %u, engine: %s\n\n", image.memory.size() >> 20, codeSize >> 20, Memory::ModuleTimestamp(module), EngineName(detected));
+
+    // Per-signature report
+    bool allUnique = true;
+    std::printf("%-34s %8s %7s %10s %12s\n", "Signature", "Matches", "Unique", "First RVA", "Scan (ms)");
+    for (std::size_t k = 0; k < Signatures.size(); ++k) {
+        const auto& signature = Signatures[k];
+        std::size_t matches = 0;
+        const std::uint8_t* first = nullptr;
+
+        auto start = Clock::now();
+        for (const auto& region : regions) {
+            auto data = region.data;
+            auto size = region.size;
+            while (auto match = Memory::FindPattern(data, size, signature)) {
+                if (!first)
+                    first = match;
+                ++matches;
+                size -= (match + 1) - data;
+                data = match + 1;
+            }
+        }
+        double ms = ElapsedMs(start);
+
+        std::string name = SignatureNames[(std::size_t)SignatureTable[k].sig];
+        if (SignatureTable[k].version)
+            name += std::string(" (") + SignatureTable[k].version + ")";
+
+        allUnique &= matches == 1;
+        std::printf("%-34s %8zu %7s %10zx %12.2f\n", name.c_str(), matches, matches == 1 ? "yes" : "NO", first ? (std::size_t)(first - module) : 0, ms);
+
+        if (matches == 0) {
+            start = Clock::now();
+            auto near = Memory::FindApproximate(regions, signature, std::max<std::size_t>(std::count(signature.mask.begin(), signature.mask.end(), 0xFF) / 4, 1), 3);
+            for (const auto& match : near)
+                std::printf("    near match at %zx, %zu byte(s) different: %s\n", (std::size_t)(match.address - module), match.mismatches, Memory::SuggestSignature(signature, match.address).c_str());
+            std::printf("    %zu near match(es) in %.2fms\n", near.size(), ElapsedMs(start));
+        }
+    }
+
+    // Benchmarks, each finds the first match of every signature
+    std::printf("\n%-40s %12s\n", "Benchmark", "Time (ms)");
+
+    auto start = Clock::now();
+    for (const auto& signature : Signatures)
+        LegacyPatternScan(module, image.memory.size(), signature);
+    std::printf("%-40s %12.2f\n", "Legacy, whole image, one pass per sig", ElapsedMs(start));
+
+    for (auto engine : { Memory::ScanEngine::Scalar, Memory::ScanEngine::SSE2, Memory::ScanEngine::AVX2 }) {
+        if (engine > detected)
+            continue;
+
+        Memory::CurrentScanEngine = engine;
+        start = Clock::now();
+        for (const auto& signature : Signatures)
+            Memory::FindPattern(module, image.memory.size(), signature);
+        std::string name = std::string(EngineName(engine)) + ", whole image, one pass per sig";
+        std::printf("%-40s %12.2f\n", name.c_str(), ElapsedMs(start));
+
+        start = Clock::now();
+        Memory::FindPatterns(module, image.memory.size(), Signatures);
+        name = std::string(EngineName(engine)) + ", whole image, batch";
+        std::printf("%-40s %12.2f\n", name.c_str(), ElapsedMs(start));
+    }
+    Memory::CurrentScanEngine = detected;
+
+    start = Clock::now();
+    Memory::PatternScanBatch(module, Signatures);
+    std::printf("%-40s %12.2f\n", "PatternScanBatch (code, threaded)", ElapsedMs(start));
+
+    return allUnique ? 0 : 2;
+}